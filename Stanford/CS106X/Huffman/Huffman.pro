@@ -13,6 +13,7 @@ HEADERS = $$files($$PWD/*.h)
 HEADERS += $$files($$PWD/StanfordCPPLib/*.h)
 
 QMAKE_CXXFLAGS += -std=c++0x -Wreturn-type
+unix:LIBS += -lpthread
 
 INCLUDEPATH += $$PWD/StanfordCPPLib/
 
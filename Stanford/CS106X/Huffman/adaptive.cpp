@@ -0,0 +1,203 @@
+/**
+ * File: adaptive.cpp
+ * ------------------
+ * Implementation of the adaptive Huffman tree, encoder, and decoder.
+ */
+
+#include <algorithm>
+#include "adaptive.h"
+#include "error.h"
+using namespace std;
+
+AdaptiveTree::AdaptiveTree() {
+    for (int node = 0; node < kMaxNodes; node++) {
+        weight[node] = 0;
+        parent[node] = kNone;
+        children[node][0] = children[node][1] = kNone;
+        symbol[node] = kNone;
+    }
+    fill(leaf, leaf + kNumSymbols + 1, int(kNone));
+    symbol[kRoot] = kNYT;
+    leaf[kNYT] = kRoot;
+}
+
+/**
+ * Method: encode
+ * --------------
+ * A symbol seen before is sent as the path to its leaf; a new one as the path
+ * to NYT and then the symbol itself.
+ */
+void AdaptiveTree::encode(int sym, BitWriter& bits) {
+    if (leaf[sym] != kNone) {
+        writePath(leaf[sym], bits);
+    } else {
+        writePath(leaf[kNYT], bits);
+        bits.writeBits(sym, kSymbolBits);
+    }
+    update(sym);
+}
+
+/**
+ * Method: writePath
+ * -----------------
+ * Writes the bits leading from the root to node: 0 for the first child and 1
+ * for the second.  The path is collected leaf first and written backwards.
+ */
+void AdaptiveTree::writePath(int node, BitWriter& bits) {
+    char path[kMaxNodes];
+    int depth = 0;
+    for (int n = node; n != kRoot; n = parent[n]) {
+        path[depth++] = children[parent[n]][1] == n;
+    }
+    while (depth > 0) {
+        bits.writeBits(path[--depth], 1);
+    }
+}
+
+/**
+ * Method: update
+ * --------------
+ * A new symbol first splits NYT into an internal node whose children are a new
+ * NYT and a zero-weight leaf for the symbol, numbered just below it.  Then,
+ * from the symbol's leaf up to the root, each node is swapped with the highest
+ * numbered node of the same weight, unless that is its parent, and its weight
+ * is increased.  Moving to the top of its run of equal weights before growing
+ * is what keeps the weights in order of node number.
+ */
+void AdaptiveTree::update(int sym) {
+    int node = leaf[sym];
+    if (node == kNone) {
+        int split = leaf[kNYT];
+        int newLeaf = split - 1;
+        int newNYT = split - 2;
+        symbol[split] = kNone;
+        children[split][0] = newNYT;
+        children[split][1] = newLeaf;
+        parent[newLeaf] = parent[newNYT] = split;
+        symbol[newLeaf] = sym;
+        symbol[newNYT] = kNYT;
+        leaf[sym] = newLeaf;
+        leaf[kNYT] = newNYT;
+        node = newLeaf;
+    }
+    while (node != kNone) {
+        int leader = node;
+        while (leader + 1 < kMaxNodes && weight[leader + 1] == weight[node]) leader++;
+        if (leader != node && leader != parent[node]) {
+            swapNodes(node, leader);
+            node = leader;
+        }
+        weight[node]++;
+        node = parent[node];
+    }
+}
+
+/**
+ * Method: swapNodes
+ * -----------------
+ * Exchanges the subtrees numbered a and b.  The numbers keep their parents;
+ * what moves is everything below them.
+ */
+void AdaptiveTree::swapNodes(int a, int b) {
+    swap(weight[a], weight[b]);
+    swap(symbol[a], symbol[b]);
+    swap(children[a][0], children[b][0]);
+    swap(children[a][1], children[b][1]);
+    attach(a);
+    attach(b);
+}
+
+/**
+ * Method: attach
+ * --------------
+ * Points whatever hangs below node back at it: its children's parent links,
+ * or the leaf entry of its symbol.
+ */
+void AdaptiveTree::attach(int node) {
+    if (symbol[node] == kNone) {
+        parent[children[node][0]] = node;
+        parent[children[node][1]] = node;
+    } else {
+        leaf[symbol[node]] = node;
+    }
+}
+
+AdaptiveEncoder::AdaptiveEncoder(vector<char>& out) : bits(out), finished(false) {}
+
+/**
+ * Method: encode
+ * --------------
+ * Codes each character, then drains the bit writer so that every finished byte
+ * is available to the caller.
+ */
+void AdaptiveEncoder::encode(const char *data, size_t size) {
+    if (finished) error("Cannot encode past the end of the message.");
+    for (size_t i = 0; i < size; i++) {
+        tree.encode((unsigned char) data[i], bits);
+    }
+    bits.drain();
+}
+
+void AdaptiveEncoder::finish() {
+    if (finished) return;
+    tree.encode(kPseudoEOF, bits);
+    bits.flush();
+    finished = true;
+}
+
+AdaptiveDecoder::AdaptiveDecoder() {
+    node = AdaptiveTree::kRoot;
+    symbolBits = 0;                     /* the first symbol is always new */
+    newSymbol = 0;
+    finished = false;
+}
+
+/**
+ * Method: decode
+ * --------------
+ * Walks down the tree a bit at a time.  Reaching a leaf completes its symbol;
+ * reaching NYT means the next kSymbolBits bits are a new symbol, which are
+ * collected into newSymbol.  Each decoded symbol updates the tree exactly as
+ * the encoder did, and the walk starts again at the root, or goes straight to
+ * collecting a symbol if the root is still NYT.  The bits after the pseudo-EOF
+ * must be the zero padding of its last byte.
+ */
+void AdaptiveDecoder::decode(const char *data, size_t size, vector<char>& out) {
+    for (size_t i = 0; i < size; i++) {
+        if (finished) error("Data follows the end of the message.");
+        int byte = (unsigned char) data[i];
+        for (int b = 0; b < 8; b++) {
+            int bit = (byte >> b) & 1;
+            if (finished) {
+                if (bit != 0) error("Data follows the end of the message.");
+                continue;
+            }
+            int sym;
+            if (symbolBits >= 0) {
+                newSymbol |= bit << symbolBits;
+                if (++symbolBits < AdaptiveTree::kSymbolBits) continue;
+                sym = newSymbol;
+                if (sym > kPseudoEOF) error("Compressed message is corrupt.");
+                symbolBits = -1;
+            } else {
+                node = tree.child(node, bit);
+                if (node == AdaptiveTree::kNone) error("Compressed message is corrupt.");
+                if (node == tree.nyt()) {
+                    symbolBits = 0;
+                    newSymbol = 0;
+                    continue;
+                }
+                sym = tree.symbolAt(node);
+                if (sym == AdaptiveTree::kNone) continue;
+            }
+            if (sym == kPseudoEOF) {
+                finished = true;
+                continue;
+            }
+            out.push_back(char(sym));
+            tree.update(sym);
+            node = AdaptiveTree::kRoot;
+            if (tree.nyt() == AdaptiveTree::kRoot) symbolBits = 0;
+        }
+    }
+}
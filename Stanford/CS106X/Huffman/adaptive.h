@@ -0,0 +1,194 @@
+/**
+ * File: adaptive.h
+ * ----------------
+ * Defines an adaptive Huffman coder for short messages and live streams.
+ * Unlike Encoding, which counts a whole block and sends its code up front,
+ * the adaptive coder starts from an empty code and updates it after every
+ * character, using the FGK algorithm.  The decoder makes the same updates,
+ * so nothing but the codes themselves is sent: there is no header and no
+ * second pass, and each character can be decoded as soon as its bits
+ * arrive.
+ */
+
+#ifndef _adaptive_
+#define _adaptive_
+
+#include <stdint.h>
+#include <vector>
+#include "bstream.h"
+#include "codebook.h"
+
+/*
+ * Class: AdaptiveTree
+ * -------------------
+ * The code tree shared by the adaptive encoder and decoder.  Every symbol
+ * not seen yet is represented by a single zero-weight leaf, NYT ("not yet
+ * transmitted"); a new symbol is sent as NYT's code followed by the symbol
+ * itself in kSymbolBits bits, after which it gets a leaf of its own split
+ * off NYT.  Nodes are kept numbered in order of weight, with siblings next
+ * to each other, and update restores that order after each symbol by
+ * swapping nodes within a run of equal weights, which keeps the tree a
+ * Huffman tree for the counts so far.
+ */
+class AdaptiveTree {
+public:
+    /* Bits used to send a symbol the first time it appears. */
+    static const int kSymbolBits = 9;
+
+    /* Node numbers run from 0 to kMaxNodes - 1; the root is the last. */
+    static const int kMaxNodes = 2 * kNumSymbols + 1;
+    static const int kRoot = kMaxNodes - 1;
+    static const int kNone = -1;
+
+    /*
+     * Constructor: AdaptiveTree()
+     * usage: AdaptiveTree tree;
+     * --------------------------------
+     * Starts with a tree that is only NYT.
+     */
+    AdaptiveTree();
+
+    /*
+     * Method: encode
+     * usage: tree.encode(symbol, bits);
+     * --------------------------------
+     * Writes the code for symbol, which is a character or kPseudoEOF, and
+     * updates the tree for it.
+     */
+    void encode(int symbol, BitWriter& bits);
+
+    /*
+     * Method: update
+     * usage: tree.update(symbol);
+     * --------------------------------
+     * Counts one more occurrence of symbol, adding a leaf for it if it is
+     * new.
+     */
+    void update(int symbol);
+
+    /*
+     * Methods: child, symbolAt, nyt
+     * --------------------------------
+     * Let a decoder walk the tree: child gives the node reached from node by
+     * bit, symbolAt the symbol at a leaf or kNone at an internal node, and
+     * nyt the leaf standing for new symbols.
+     */
+    int child(int node, int bit) const;
+    int symbolAt(int node) const;
+    int nyt() const;
+
+private:
+    static const int kNYT = kNumSymbols;    /* symbol stored at the NYT leaf */
+
+    int weight[kMaxNodes];
+    int parent[kMaxNodes];
+    int children[kMaxNodes][2];
+    int symbol[kMaxNodes];                  /* kNone for internal nodes */
+    int leaf[kNumSymbols + 1];              /* node for each symbol, or kNone */
+
+    void swapNodes(int a, int b);
+    void attach(int node);
+    void writePath(int node, BitWriter& bits);
+};
+
+inline int AdaptiveTree::child(int node, int bit) const {
+    return children[node][bit];
+}
+
+inline int AdaptiveTree::symbolAt(int node) const {
+    return symbol[node];
+}
+
+inline int AdaptiveTree::nyt() const {
+    return leaf[kNYT];
+}
+
+/*
+ * Class: AdaptiveEncoder
+ * ----------------------
+ * Adaptively codes characters onto the end of a vector.  After each call
+ * to encode, every whole byte of output is in the vector, so a reader can
+ * be sent everything but the last few bits of the message so far.
+ */
+class AdaptiveEncoder {
+public:
+    /*
+     * Constructor: AdaptiveEncoder(out)
+     * usage: AdaptiveEncoder encoder(out);
+     * --------------------------------
+     * Starts a message that is appended to out, which must outlive the
+     * encoder.
+     */
+    explicit AdaptiveEncoder(std::vector<char>& out);
+
+    /*
+     * Method: encode
+     * usage: encoder.encode(data, size);
+     * --------------------------------
+     * Codes the size characters at data.
+     */
+    void encode(const char *data, size_t size);
+
+    /*
+     * Method: finish
+     * usage: encoder.finish();
+     * --------------------------------
+     * Ends the message with the pseudo-EOF and pads it to a whole byte.
+     * Nothing more may be encoded afterwards.
+     */
+    void finish();
+
+private:
+    AdaptiveTree tree;
+    BitWriter bits;
+    bool finished;
+};
+
+/*
+ * Class: AdaptiveDecoder
+ * ----------------------
+ * Decodes a message written by AdaptiveEncoder, which may arrive in pieces
+ * of any size: the decoder keeps its place in the tree between pieces and
+ * hands out each character as soon as its last bit arrives.
+ */
+class AdaptiveDecoder {
+public:
+    /*
+     * Constructor: AdaptiveDecoder()
+     * usage: AdaptiveDecoder decoder;
+     * --------------------------------
+     * Gets ready for the start of a message.
+     */
+    AdaptiveDecoder();
+
+    /*
+     * Method: decode
+     * usage: decoder.decode(data, size, out);
+     * --------------------------------
+     * Decodes the next size bytes of the message, appending the characters
+     * they complete to out.  Stops at the pseudo-EOF; raises an error if
+     * anything but padding follows it.
+     */
+    void decode(const char *data, size_t size, std::vector<char>& out);
+
+    /*
+     * Method: isFinished
+     * usage: if (decoder.isFinished()) ...
+     * --------------------------------
+     * Returns true once the pseudo-EOF has been decoded.
+     */
+    bool isFinished() const;
+
+private:
+    AdaptiveTree tree;
+    int node;           /* where the walk down the tree has got to */
+    int symbolBits;     /* bits of a new symbol read so far, or -1 */
+    int newSymbol;
+    bool finished;
+};
+
+inline bool AdaptiveDecoder::isFinished() const {
+    return finished;
+}
+
+#endif
@@ -0,0 +1,476 @@
+/**
+ * File: batch.cpp
+ * ---------------
+ * Implementation of the batch commands.  Files are handed to a thread pool,
+ * one task per file, and the results are printed in the order the files
+ * were given once each one is done.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "batch.h"
+#include "benchmark.h"
+#include "bstream.h"
+#include "cmdline.h"
+#include "encoding.h"
+#include "error.h"
+#include "filelib.h"
+#include "strlib.h"
+#include "suite.h"
+#include "threadpool.h"
+#include "verify.h"
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+using namespace std;
+
+static const string kCompressedSuffix = ".huf";
+static const int kRounds = 3;          /* bench reports the best of this many runs */
+static const int kUsageError = 2;      /* exit status for arguments we cannot use */
+
+enum Command { COMPRESS, DECOMPRESS, VERIFY, BENCH };
+
+/*
+ * Everything the command line asked for.  A threads value of 0 means the
+ * default, the hardware threads divided among the jobs.
+ */
+struct BatchOptions {
+    Command command;
+    int jobs;
+    int threads;
+    int level;
+    int blockSize;
+    bool overwrite;
+    bool checksum;
+    bool contexts;
+    vector<string> files;
+};
+
+/*
+ * What happened to one file.  Sizes are those of the original and the
+ * compressed data, whichever way the file went, and the times are zero for
+ * any direction that was not run.  The checksum is of the original data and
+ * is only filled in when asked for.  A failed file has only its message.
+ */
+struct FileResult {
+    string message;
+    long original;
+    long compressed;
+    double compressSeconds;
+    double decompressSeconds;
+    long peakBytes;
+    uint32_t checksum;
+};
+
+/**
+ * Function: printUsage
+ * --------------------
+ * Describes the command line on cerr.
+ */
+static void printUsage(const string& program) {
+    cerr << "usage: " << program << " compress|decompress|verify|bench [options] file..." << endl
+         << "  -j jobs      files worked on at once (default 1)" << endl
+         << "  -t threads   threads used on each file" << endl
+         << "  -l level     compression level, " << kMinLevel << " to " << kMaxLevel << endl
+         << "  -b bytes     block size" << endl
+         << "  -f           overwrite existing output files" << endl
+         << "  -c           print the CRC-32 of each original file" << endl
+         << "  -x           code each character by the one before it where that is smaller" << endl
+         << "or: " << program << " suite [options], described in suite.h" << endl
+         << "With no arguments the program runs interactively." << endl;
+}
+
+/**
+ * Function: parseOptions
+ * ----------------------
+ * Fills in options from argv, raising an error for anything it does not
+ * recognize.  Levels and block sizes are checked by setting them on a
+ * scratch Encoding, so they are held to the same limits compress uses.
+ */
+static void parseOptions(int argc, char **argv, BatchOptions& options) {
+    if (argc < 2) error("No command given.");
+    string command = argv[1];
+    if (command == "compress") {
+        options.command = COMPRESS;
+    } else if (command == "decompress") {
+        options.command = DECOMPRESS;
+    } else if (command == "verify") {
+        options.command = VERIFY;
+    } else if (command == "bench") {
+        options.command = BENCH;
+    } else {
+        error("Unknown command \"" + command + "\".");
+    }
+    options.jobs = 1;
+    options.threads = 0;
+    options.level = kMinLevel;
+    options.blockSize = 0;
+    options.overwrite = false;
+    options.checksum = false;
+    options.contexts = false;
+    Encoding check;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.size() < 2 || arg[0] != '-') {
+            options.files.push_back(arg);
+            continue;
+        }
+        if (arg == "-f") {
+            options.overwrite = true;
+            continue;
+        }
+        if (arg == "-c") {
+            options.checksum = true;
+            continue;
+        }
+        if (arg == "-x") {
+            options.contexts = true;
+            continue;
+        }
+        if (arg != "-j" && arg != "-t" && arg != "-l" && arg != "-b") {
+            error("Unknown option " + arg + ".");
+        }
+        if (i + 1 == argc) error("Option " + arg + " needs a value.");
+        int value = parseInteger(argv[++i], "Option " + arg);
+        if (arg == "-j") {
+            if (value <= 0) error("Job count out of range.");
+            options.jobs = value;
+        } else if (arg == "-t") {
+            check.setNumThreads(value);
+            options.threads = value;
+        } else if (arg == "-l") {
+            check.setLevel(value);
+            options.level = value;
+        } else {
+            check.setBlockSize(value);
+            options.blockSize = value;
+        }
+    }
+    if (options.files.empty()) error("No files given.");
+}
+
+/**
+ * Function: configure
+ * -------------------
+ * Applies the options to the Encoding for one file.
+ */
+static void configure(Encoding& encoding, const BatchOptions& options) {
+    int threads = options.threads;
+    if (threads == 0) {
+        threads = max(1, int(thread::hardware_concurrency()) / options.jobs);
+    }
+    encoding.setNumThreads(threads);
+    encoding.setLevel(options.level);
+    if (options.blockSize != 0) encoding.setBlockSize(options.blockSize);
+    encoding.setContextModeling(options.contexts);
+}
+
+/**
+ * Function: peakResidentBytes
+ * ---------------------------
+ * Returns the most memory the process has had resident at once, or 0 where
+ * the system does not say.  Linux reports kilobytes and OS X bytes.
+ */
+static long peakResidentBytes() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024L;
+#endif
+#endif
+}
+
+/**
+ * Function: openOutput
+ * --------------------
+ * Opens name for writing, refusing to replace an existing file unless the
+ * options allow it.
+ */
+static void openOutput(obstream& outfile, const string& name, const BatchOptions& options) {
+    if (!options.overwrite && fileExists(name)) {
+        error(name + " already exists; use -f to overwrite it.");
+    }
+    outfile.open(name.c_str());
+    if (!outfile.is_open()) error("Cannot write " + name + ".");
+}
+
+/**
+ * Function: originalName
+ * ----------------------
+ * Returns the name the compressed file name decompresses to, which is name
+ * without its suffix, raising an error if it does not have the suffix.
+ */
+static string originalName(const string& name) {
+    if (!endsWith(name, kCompressedSuffix) || name.size() == kCompressedSuffix.size()) {
+        error(name + " does not end in " + kCompressedSuffix + ".");
+    }
+    return name.substr(0, name.size() - kCompressedSuffix.size());
+}
+
+/**
+ * Function: openInput
+ * -------------------
+ * Maps name for reading, which must be an existing regular file: a directory
+ * or a device would open, but reading it gives nothing sensible.
+ */
+static void openInput(ibstream& infile, const string& name) {
+    if (!fileExists(name)) error(name + " not found.");
+    struct stat info;
+    if (stat(name.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) error(name + " is not a regular file.");
+    infile.openMapped(name.c_str());
+    if (infile.fail()) error("Cannot read " + name + ".");
+}
+
+/**
+ * Function: compressFile
+ * ----------------------
+ * Compresses name into name.huf.  The time covers reading, coding, and
+ * writing the file.
+ */
+static void compressFile(const string& name, const BatchOptions& options, FileResult& result) {
+    Encoding encoding;
+    configure(encoding, options);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ibstream infile;
+    openInput(infile, name);
+    obstream outfile;
+    openOutput(outfile, name + kCompressedSuffix, options);
+    result.original = encoding.compress(infile, outfile);
+    result.compressed = outfile.size();
+    infile.close();
+    outfile.close();
+    result.compressSeconds = secondsSince(start);
+}
+
+/**
+ * Function: decompressFile
+ * ------------------------
+ * Decompresses name, which must end in .huf, into the same name without it.
+ */
+static void decompressFile(const string& name, const BatchOptions& options, FileResult& result) {
+    string original = originalName(name);
+    Encoding encoding;
+    configure(encoding, options);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ibstream infile;
+    openInput(infile, name);
+    obstream outfile;
+    openOutput(outfile, original, options);
+    encoding.decompress(infile, outfile);
+    result.compressed = infile.size();
+    result.original = outfile.size();
+    infile.close();
+    outfile.close();
+    result.decompressSeconds = secondsSince(start);
+}
+
+/**
+ * Function: checkRoundTrip
+ * ------------------------
+ * Raises an error unless decompressed holds exactly the size bytes at data.
+ */
+static void checkRoundTrip(const string& name, const char *data, size_t size,
+                           const vector<char>& decompressed) {
+    if (decompressed.size() != size) {
+        error("Decompressing " + name + " gave " + integerToString(decompressed.size())
+              + " bytes instead of " + integerToString(size) + ".");
+    }
+    long errors = size == 0 ? 0 : countDifferingBits(data, &decompressed[0], size);
+    if (errors != 0) {
+        error("Decompressing " + name + " gave back " + integerToString(errors) + " wrong bits.");
+    }
+}
+
+/**
+ * Function: verifyFile
+ * --------------------
+ * Decompresses name.huf into memory and checks that it gives back name,
+ * without writing anything.  The time covers decompression only.
+ */
+static void verifyFile(const string& name, const BatchOptions& options, FileResult& result) {
+    Encoding encoding;
+    configure(encoding, options);
+    ibstream original;
+    openInput(original, name);
+    ibstream compressed;
+    openInput(compressed, name + kCompressedSuffix);
+    vector<char> data(original.size());
+    if (!original.isMapped() && !data.empty()) original.read(&data[0], data.size());
+    const char *expected = original.isMapped() ? original.mappedData() : data.empty() ? NULL : &data[0];
+
+    vector<char> decompressed;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (compressed.isMapped()) {
+        encoding.decompress(compressed.mappedData(), compressed.mappedSize(), decompressed);
+    } else {
+        vector<char> bytes(compressed.size());
+        if (!bytes.empty()) compressed.read(&bytes[0], bytes.size());
+        encoding.decompress(bytes.empty() ? NULL : &bytes[0], bytes.size(), decompressed);
+    }
+    result.decompressSeconds = secondsSince(start);
+    checkRoundTrip(name, expected, original.size(), decompressed);
+    result.original = original.size();
+    result.compressed = compressed.size();
+    original.close();
+    compressed.close();
+}
+
+/**
+ * Function: benchFile
+ * -------------------
+ * Reads name into memory, then compresses and decompresses it there kRounds
+ * times, keeping the best time each way.  Raises an error if the round trip
+ * does not give back the file.  Nothing is written.
+ */
+static void benchFile(const string& name, const BatchOptions& options, FileResult& result) {
+    Encoding encoding;
+    configure(encoding, options);
+    ibstream infile;
+    openInput(infile, name);
+    vector<char> data(infile.size());
+    if (!data.empty()) infile.read(&data[0], data.size());
+    infile.close();
+
+    const char *original = data.empty() ? NULL : &data[0];
+    vector<char> compressed;
+    vector<char> decompressed;
+    for (int round = 0; round < kRounds; round++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        encoding.compress(original, data.size(), compressed);
+        double seconds = secondsSince(start);
+        if (round == 0 || seconds < result.compressSeconds) result.compressSeconds = seconds;
+
+        start = chrono::steady_clock::now();
+        encoding.decompress(compressed.empty() ? NULL : &compressed[0], compressed.size(), decompressed);
+        seconds = secondsSince(start);
+        if (round == 0 || seconds < result.decompressSeconds) result.decompressSeconds = seconds;
+    }
+    checkRoundTrip(name, original, data.size(), decompressed);
+    result.original = data.size();
+    result.compressed = compressed.size();
+}
+
+/**
+ * Function: processFile
+ * ---------------------
+ * Runs the command on one file, turning any error into the result's
+ * message, and notes the peak memory once it is done.  The checksum is
+ * streamed from the original file afterwards, so it is not timed.
+ */
+static void processFile(const string& name, const BatchOptions& options, FileResult& result) {
+    try {
+        switch (options.command) {
+            case COMPRESS: compressFile(name, options, result); break;
+            case DECOMPRESS: decompressFile(name, options, result); break;
+            case VERIFY: verifyFile(name, options, result); break;
+            case BENCH: benchFile(name, options, result); break;
+        }
+        if (options.checksum) {
+            result.checksum = fileChecksum(options.command == DECOMPRESS ? originalName(name) : name);
+        }
+    } catch (ErrorException& ex) {
+        result.message = ex.getMessage();
+    }
+    result.peakBytes = peakResidentBytes();
+}
+
+/**
+ * Function: printStatistics
+ * -------------------------
+ * Prints the sizes, ratio of compressed to original size, throughput in
+ * MB/s of original data, and peak memory, for a file or for the totals.
+ * Throughput is only printed for directions that took any time.  The line
+ * is left open for the caller to finish.
+ */
+static void printStatistics(const string& label, long original, long compressed,
+                            double compressSeconds, double decompressSeconds, long peakBytes) {
+    cout << label << ": " << original << " -> " << compressed << " bytes";
+    if (original > 0) cout << ", ratio " << double(compressed) / original;
+    if (compressSeconds > 0) cout << ", compress " << original / compressSeconds / (1 << 20) << " MB/s";
+    if (decompressSeconds > 0) cout << ", decompress " << original / decompressSeconds / (1 << 20) << " MB/s";
+    if (peakBytes > 0) cout << ", peak RSS " << double(peakBytes) / (1 << 20) << " MiB";
+}
+
+/**
+ * Function: runBatch
+ * ------------------
+ * Queues every file, then waits for them in order, printing each result as
+ * it is collected.  The totals give throughput over the wall-clock time of
+ * the whole batch when files were compressed or decompressed, so that they
+ * show what running jobs side by side gained.  Verify and bench totals add
+ * up the per-file times instead, since those leave out reading the files
+ * and, for bench, are each a best of several runs.
+ */
+int runBatch(int argc, char **argv) {
+    if (argc > 1 && string(argv[1]) == "suite") return runSuite(argc, argv);
+    BatchOptions options;
+    try {
+        parseOptions(argc, argv, options);
+    } catch (ErrorException& ex) {
+        cerr << ex.getMessage() << endl;
+        printUsage(argc > 0 ? getTail(argv[0]) : "huffman");
+        return kUsageError;
+    }
+
+    int numFiles = options.files.size();
+    vector<FileResult> results(numFiles);
+    vector<future<void> > done;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ThreadPool pool(options.jobs > 1 ? min(options.jobs, numFiles) : 0);
+    for (int i = 0; i < numFiles; i++) {
+        FileResult& result = results[i];
+        result.original = result.compressed = 0;
+        result.compressSeconds = result.decompressSeconds = 0;
+        const string& name = options.files[i];
+        done.push_back(pool.submit([&options, &name, &result]() {
+            processFile(name, options, result);
+        }));
+    }
+
+    cout << fixed << setprecision(3);
+    long original = 0, compressed = 0;
+    double compressSeconds = 0, decompressSeconds = 0;
+    int failures = 0;
+    for (int i = 0; i < numFiles; i++) {
+        done[i].get();
+        const FileResult& result = results[i];
+        if (!result.message.empty()) {
+            cerr << options.files[i] << ": " << result.message << endl;
+            failures++;
+            continue;
+        }
+        printStatistics(options.files[i], result.original, result.compressed,
+                        result.compressSeconds, result.decompressSeconds, result.peakBytes);
+        if (options.checksum) {
+            cout << ", crc32 " << hex << setw(8) << setfill('0') << result.checksum
+                 << dec << setfill(' ');
+        }
+        cout << endl;
+        original += result.original;
+        compressed += result.compressed;
+        compressSeconds += result.compressSeconds;
+        decompressSeconds += result.decompressSeconds;
+    }
+    if (options.command == COMPRESS || options.command == DECOMPRESS) {
+        double seconds = secondsSince(start);
+        if (options.command == COMPRESS) compressSeconds = seconds;
+        else decompressSeconds = seconds;
+    }
+    printStatistics("total (" + integerToString(numFiles - failures) + " of "
+                    + integerToString(numFiles) + " files)",
+                    original, compressed, compressSeconds, decompressSeconds, peakResidentBytes());
+    cout << endl;
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
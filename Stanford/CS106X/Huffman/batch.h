@@ -0,0 +1,45 @@
+/**
+ * File: batch.h
+ * -------------
+ * The non-interactive side of the Huffman program.  When it is started with
+ * arguments, main hands them to runBatch instead of opening the console, so
+ * that files can be compressed, decompressed, checked, or benchmarked from
+ * scripts and build jobs:
+ *
+ *     huffman compress   [options] file...    writes file.huf for each file
+ *     huffman decompress [options] file.huf... writes each file without .huf
+ *     huffman verify     [options] file...    checks file.huf against file
+ *     huffman bench      [options] file...    times both ways in memory
+ *
+ * The options are
+ *
+ *     -j jobs      files worked on at once (default 1)
+ *     -t threads   threads used on each file (default: the hardware threads
+ *                  shared out among the jobs)
+ *     -l level     compression level, 0 to 9 (default 0)
+ *     -b bytes     block size (default 1 MiB)
+ *     -f           overwrite output files that already exist
+ *     -c           print the CRC-32 of each original file, to compare
+ *                  with one recorded elsewhere
+ *     -x           try order-1 context modeling on each block, keeping it
+ *                  where it comes out smaller
+ *
+ * Each file gets a line with its sizes, compression ratio, throughput, and
+ * the process's peak resident memory so far, followed by a line of totals.
+ * "huffman suite" runs the benchmark suite in suite.h instead.
+ */
+
+#ifndef _batch_
+#define _batch_
+
+/*
+ * Function: runBatch
+ * usage: return runBatch(argc, argv);
+ * --------------------------------
+ * Carries out the command in argv and returns the exit status for main:
+ * 0 if every file was processed, 1 if any failed, and 2 if the arguments
+ * could not be understood, in which case a usage message is printed.
+ */
+int runBatch(int argc, char **argv);
+
+#endif
@@ -0,0 +1,447 @@
+/**
+ * File: benchmark.cpp
+ * -------------------
+ * Implementation of the Encoding benchmarks.  Scratch files are written
+ * next to the inputs and removed afterwards.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "benchmark.h"
+#include "adaptive.h"
+#include "encoding.h"
+#include "bstream.h"
+#include "histogram.h"
+#include "map.h"
+#include "foreach.h"
+using namespace std;
+
+static const int kRounds = 3; /* each measurement is the best of this many runs. */
+static const int kMessageRuns = 1000; /* short message timings are averaged over this many runs. */
+static const int kRangeReads = 1000;  /* random reads timed for each block size */
+static const int kRangeLength = 100;  /* characters in each random read */
+static const string kCompressedSuffix = ".bench-compressed";
+static const string kDecompressedSuffix = ".bench-decompressed";
+
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Function: megabytesPerSecond
+ * ----------------------------
+ * Converts a byte count and a duration into MB/s.
+ */
+static double megabytesPerSecond(long bytes, double seconds) {
+    return seconds > 0 ? bytes / seconds / (1 << 20) : 0;
+}
+
+/**
+ * Function: readFile
+ * ------------------
+ * Reads the whole of the named file into memory.
+ */
+static vector<char> readFile(const string& name) {
+    ibstream infile;
+    infile.open(name.c_str());
+    vector<char> data(infile.size());
+    if (!data.empty()) infile.read(&data[0], data.size());
+    infile.close();
+    return data;
+}
+
+/**
+ * Function: fileSize
+ * ------------------
+ * Returns the size in bytes of the named file.
+ */
+static long fileSize(const string& name) {
+    ibstream infile;
+    infile.open(name.c_str());
+    long size = infile.size();
+    infile.close();
+    return size;
+}
+
+/**
+ * Function: compressFile
+ * ----------------------
+ * Compresses source into dest, with codes no longer than maxCodeLength bits
+ * and with interleaved payloads if asked for, and returns the size of the
+ * source in bytes.
+ */
+static long compressFile(const string& source, const string& dest, int maxCodeLength = 15,
+                         bool interleaved = false) {
+    Encoding encoding;
+    encoding.setNumThreads(1);
+    encoding.setMaxCodeLength(maxCodeLength);
+    encoding.setInterleaved(interleaved);
+    ibstream infile;
+    infile.open(source.c_str());
+    obstream outfile;
+    outfile.open(dest.c_str());
+    encoding.compress(infile, outfile);
+    long size = infile.size();
+    infile.close();
+    outfile.close();
+    return size;
+}
+
+/**
+ * Function: timeCompress
+ * ----------------------
+ * Compresses source into dest with the given encoder and number of threads,
+ * mapping source if asked to, kRounds times and returns the fastest time in
+ * seconds.  Opening the source is part of the time, since mapping does work
+ * there.
+ */
+static double timeCompress(const string& source, const string& dest, Encoding::EncoderKind kind,
+                           int numThreads = 1, bool mapped = false) {
+    double best = -1;
+    for (int round = 0; round < kRounds; round++) {
+        Encoding encoding;
+        encoding.setEncoder(kind);
+        encoding.setNumThreads(numThreads);
+        ibstream infile;
+        chrono::steady_clock::time_point opened = chrono::steady_clock::now();
+        if (mapped) {
+            infile.openMapped(source.c_str());
+        } else {
+            infile.open(source.c_str());
+        }
+        obstream outfile;
+        outfile.open(dest.c_str());
+        encoding.compress(infile, outfile);
+        outfile.flush();
+        double seconds = secondsSince(opened);
+        infile.close();
+        outfile.close();
+        if (best < 0 || seconds < best) best = seconds;
+    }
+    return best;
+}
+
+/**
+ * Function: timeDecompress
+ * ------------------------
+ * Decompresses source into dest with the given decoder and number of threads,
+ * mapping source if asked to, kRounds times and returns the fastest time in
+ * seconds, including the time to open the source.  Reports an error if the output size
+ * does not match the original.
+ */
+static double timeDecompress(const string& source, const string& dest,
+                             Encoding::DecoderKind kind, long originalSize, int numThreads = 1,
+                             bool mapped = false) {
+    double best = -1;
+    for (int round = 0; round < kRounds; round++) {
+        Encoding encoding;
+        encoding.setDecoder(kind);
+        encoding.setNumThreads(numThreads);
+        ibstream infile;
+        chrono::steady_clock::time_point opened = chrono::steady_clock::now();
+        if (mapped) {
+            infile.openMapped(source.c_str());
+        } else {
+            infile.open(source.c_str());
+        }
+        obstream outfile;
+        outfile.open(dest.c_str());
+        encoding.decompress(infile, outfile);
+        outfile.flush();
+        double seconds = secondsSince(opened);
+        if (outfile.size() != originalSize) cout << "  (output size mismatch!)" << endl;
+        infile.close();
+        outfile.close();
+        if (best < 0 || seconds < best) best = seconds;
+    }
+    return best;
+}
+
+void benchmarkDecoders(const Vector<string>& files) {
+    foreach (string file in files) {
+        string compressed = file + kCompressedSuffix;
+        string decompressed = file + kDecompressedSuffix;
+        long size = compressFile(file, compressed);
+        double treeSeconds = timeDecompress(compressed, decompressed, Encoding::TREE_WALK, size);
+        double tableSeconds = timeDecompress(compressed, decompressed, Encoding::TABLE_LOOKUP, size);
+        long singleSize = fileSize(compressed);
+        compressFile(file, compressed, 15, true);
+        double streamsSeconds = timeDecompress(compressed, decompressed, Encoding::TABLE_LOOKUP, size);
+        long interleavedSize = fileSize(compressed);
+        cout << file << " (" << size << " bytes)" << endl;
+        cout << "  tree walk:    " << megabytesPerSecond(size, treeSeconds) << " MB/s" << endl;
+        cout << "  table lookup: " << megabytesPerSecond(size, tableSeconds) << " MB/s" << endl;
+        cout << "  four streams: " << megabytesPerSecond(size, streamsSeconds) << " MB/s (+"
+             << interleavedSize - singleSize << " bytes)" << endl;
+        remove(compressed.c_str());
+        remove(decompressed.c_str());
+    }
+}
+
+void benchmarkEncoders(const Vector<string>& files) {
+    foreach (string file in files) {
+        string compressed = file + kCompressedSuffix;
+        long size = fileSize(file);
+        double stringSeconds = timeCompress(file, compressed, Encoding::STRING_PATHS);
+        double packedSeconds = timeCompress(file, compressed, Encoding::PACKED_CODES);
+        cout << file << " (" << size << " bytes)" << endl;
+        cout << "  string paths: " << megabytesPerSecond(size, stringSeconds) << " MB/s" << endl;
+        cout << "  packed codes: " << megabytesPerSecond(size, packedSeconds) << " MB/s" << endl;
+        remove(compressed.c_str());
+    }
+}
+
+void benchmarkHistogram(const Vector<string>& files) {
+    foreach (string file in files) {
+        vector<char> data = readFile(file);
+        double mapBest = -1, arrayBest = -1;
+        long checksum = 0;   /* keeps the counts live so the loops are not optimized away */
+        for (int round = 0; round < kRounds; round++) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            Map<int, int> map;
+            for (size_t i = 0; i < data.size(); i++) {
+                int num = (unsigned char) data[i];
+                if (!map.containsKey(num)) {
+                    map.put(num, 1);
+                } else {
+                    map[num]++;
+                }
+            }
+            double seconds = secondsSince(start);
+            if (mapBest < 0 || seconds < mapBest) mapBest = seconds;
+            checksum += map.size();
+
+            start = chrono::steady_clock::now();
+            uint32_t counts[kNumByteValues] = {};
+            countBytes(data.empty() ? NULL : &data[0], data.size(), counts);
+            seconds = secondsSince(start);
+            if (arrayBest < 0 || seconds < arrayBest) arrayBest = seconds;
+            checksum += counts[0];
+        }
+        cout << file << " (" << data.size() << " bytes, checksum " << checksum << ")" << endl;
+        cout << "  Map<int, int>: " << megabytesPerSecond(data.size(), mapBest) << " MB/s" << endl;
+        cout << "  countBytes:    " << megabytesPerSecond(data.size(), arrayBest) << " MB/s" << endl;
+    }
+}
+
+void reportCodeLengthLimits(const Vector<string>& files) {
+    foreach (string file in files) {
+        string compressed = file + kCompressedSuffix;
+        long size = compressFile(file, compressed, kMaxCodeLength);
+        long unlimited = fileSize(compressed);
+        cout << file << " (" << size << " bytes)" << endl;
+        cout << "  unlimited: " << unlimited << " bytes" << endl;
+        for (int limit = 11; limit <= 15; limit++) {
+            compressFile(file, compressed, limit);
+            long limited = fileSize(compressed);
+            cout << "  " << limit << " bits:   " << limited << " bytes (+"
+                 << 100.0 * (limited - unlimited) / unlimited << "%)" << endl;
+        }
+        remove(compressed.c_str());
+    }
+}
+
+void benchmarkMappedInput(const Vector<string>& files) {
+    foreach (string file in files) {
+        string compressed = file + kCompressedSuffix;
+        string decompressed = file + kDecompressedSuffix;
+        long size = compressFile(file, compressed);
+        double streamCompress = timeCompress(file, compressed, Encoding::PACKED_CODES, 1, false);
+        double mappedCompress = timeCompress(file, compressed, Encoding::PACKED_CODES, 1, true);
+        double streamDecompress = timeDecompress(compressed, decompressed, Encoding::TABLE_LOOKUP, size, 1, false);
+        double mappedDecompress = timeDecompress(compressed, decompressed, Encoding::TABLE_LOOKUP, size, 1, true);
+        cout << file << " (" << size << " bytes)" << endl;
+        cout << "  compress:   stream " << megabytesPerSecond(size, streamCompress) << " MB/s, mapped "
+             << megabytesPerSecond(size, mappedCompress) << " MB/s" << endl;
+        cout << "  decompress: stream " << megabytesPerSecond(size, streamDecompress) << " MB/s, mapped "
+             << megabytesPerSecond(size, mappedDecompress) << " MB/s" << endl;
+        remove(compressed.c_str());
+        remove(decompressed.c_str());
+    }
+}
+
+void benchmarkThreads(const Vector<string>& files, int maxThreads) {
+    foreach (string file in files) {
+        string compressed = file + kCompressedSuffix;
+        string decompressed = file + kDecompressedSuffix;
+        long size = compressFile(file, compressed);
+        cout << file << " (" << size << " bytes)" << endl;
+        double compressOne = 0, decompressOne = 0;
+        for (int threads = 1; threads <= maxThreads; threads++) {
+            double compressSeconds = timeCompress(file, compressed, Encoding::PACKED_CODES, threads);
+            double decompressSeconds = timeDecompress(compressed, decompressed, Encoding::TABLE_LOOKUP,
+                                                      size, threads);
+            if (threads == 1) {
+                compressOne = compressSeconds;
+                decompressOne = decompressSeconds;
+            }
+            cout << "  " << threads << " thread(s): compress "
+                 << megabytesPerSecond(size, compressSeconds) << " MB/s (x"
+                 << compressOne / compressSeconds << "), decompress "
+                 << megabytesPerSecond(size, decompressSeconds) << " MB/s (x"
+                 << decompressOne / decompressSeconds << ")" << endl;
+        }
+        remove(compressed.c_str());
+        remove(decompressed.c_str());
+    }
+}
+
+void benchmarkLevels(const Vector<string>& files) {
+    foreach (string file in files) {
+        vector<char> data = readFile(file);
+        const char *bytes = data.empty() ? NULL : &data[0];
+        cout << file << " (" << data.size() << " bytes)" << endl;
+        for (int level = kMinLevel; level <= kMaxLevel; level++) {
+            Encoding encoding;
+            encoding.setNumThreads(1);
+            encoding.setLevel(level);
+            vector<char> compressed, decompressed;
+            double compressBest = -1, decompressBest = -1;
+            for (int round = 0; round < kRounds; round++) {
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                encoding.compress(bytes, data.size(), compressed);
+                double seconds = secondsSince(start);
+                if (compressBest < 0 || seconds < compressBest) compressBest = seconds;
+
+                start = chrono::steady_clock::now();
+                encoding.decompress(&compressed[0], compressed.size(), decompressed);
+                seconds = secondsSince(start);
+                if (decompressBest < 0 || seconds < decompressBest) decompressBest = seconds;
+            }
+            if (decompressed != data) cout << "  (output mismatch!)" << endl;
+            cout << "  level " << level << ": " << 100.0 * compressed.size() / max(size_t(1), data.size())
+                 << "% of original, compress " << megabytesPerSecond(data.size(), compressBest)
+                 << " MB/s, decompress " << megabytesPerSecond(data.size(), decompressBest) << " MB/s" << endl;
+        }
+    }
+}
+
+void benchmarkAdaptive(const Vector<string>& files) {
+    foreach (string file in files) {
+        vector<char> data = readFile(file);
+        cout << file << endl;
+        for (size_t size = 16; size <= 4096 && size <= data.size(); size *= 4) {
+            vector<char> message(data.begin(), data.begin() + size);
+            Encoding encoding;
+            encoding.setNumThreads(1);
+            vector<char> compressed, decompressed;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (int run = 0; run < kMessageRuns; run++) {
+                encoding.compress(&message[0], size, compressed);
+            }
+            double staticSeconds = secondsSince(start) / kMessageRuns;
+            start = chrono::steady_clock::now();
+            for (int run = 0; run < kMessageRuns; run++) {
+                encoding.decompress(&compressed[0], compressed.size(), decompressed);
+            }
+            double staticDecodeSeconds = secondsSince(start) / kMessageRuns;
+            if (decompressed != message) cout << "  (output mismatch!)" << endl;
+
+            vector<char> adaptive;
+            double firstByteSeconds = 0;
+            for (int run = 0; run < kMessageRuns; run++) {
+                adaptive.clear();
+                AdaptiveEncoder encoder(adaptive);
+                start = chrono::steady_clock::now();
+                for (size_t i = 0; i < size && adaptive.empty(); i++) {
+                    encoder.encode(&message[i], 1);
+                }
+                firstByteSeconds += secondsSince(start);
+            }
+            adaptive.clear();
+            AdaptiveEncoder encoder(adaptive);
+            encoder.encode(&message[0], size);
+            encoder.finish();
+
+            /* The decoder is fed one byte at a time, as if they were arriving. */
+            double firstCharSeconds = 0;
+            for (int run = 0; run < kMessageRuns; run++) {
+                decompressed.clear();
+                AdaptiveDecoder decoder;
+                start = chrono::steady_clock::now();
+                for (size_t i = 0; i < adaptive.size() && decompressed.empty(); i++) {
+                    decoder.decode(&adaptive[i], 1, decompressed);
+                }
+                firstCharSeconds += secondsSince(start);
+            }
+            decompressed.clear();
+            AdaptiveDecoder decoder;
+            decoder.decode(&adaptive[0], adaptive.size(), decompressed);
+            if (!decoder.isFinished() || decompressed != message) cout << "  (output mismatch!)" << endl;
+            cout << "  " << size << " bytes: static " << compressed.size() << " bytes, first byte after "
+                 << staticSeconds * 1e6 << " us, first character after " << staticDecodeSeconds * 1e6
+                 << " us; adaptive " << adaptive.size() << " bytes, first byte after "
+                 << firstByteSeconds / kMessageRuns * 1e6 << " us, first character after "
+                 << firstCharSeconds / kMessageRuns * 1e6 << " us" << endl;
+        }
+    }
+}
+
+void benchmarkRangeReads(const Vector<string>& files) {
+    foreach (string file in files) {
+        string compressed = file + kCompressedSuffix;
+        long size = fileSize(file);
+        cout << file << " (" << size << " bytes)" << endl;
+        if (size < kRangeLength) continue;
+        for (int blockSize = 1 << 14; blockSize <= 1 << 20; blockSize *= 4) {
+            Encoding encoding;
+            encoding.setNumThreads(1);
+            encoding.setBlockSize(blockSize);
+            ibstream infile;
+            infile.open(file.c_str());
+            obstream outfile;
+            outfile.open(compressed.c_str());
+            encoding.compress(infile, outfile);
+            infile.close();
+            outfile.close();
+
+            ibstream archive;
+            archive.openMapped(compressed.c_str());
+            mt19937 random(blockSize);          /* the same offsets every run */
+            uniform_int_distribution<long> offsets(0, size - kRangeLength);
+            vector<char> range;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (int read = 0; read < kRangeReads; read++) {
+                encoding.decompressRange(archive, offsets(random), kRangeLength, range);
+            }
+            double seconds = secondsSince(start);
+            cout << "  " << blockSize / 1024 << " KiB blocks: " << archive.size() << " bytes, "
+                 << seconds / kRangeReads * 1000 << " ms per read" << endl;
+            archive.close();
+        }
+        remove(compressed.c_str());
+    }
+}
+
+void benchmarkContexts(const Vector<string>& files) {
+    foreach (string file in files) {
+        vector<char> data = readFile(file);
+        const char *bytes = data.empty() ? NULL : &data[0];
+        cout << file << " (" << data.size() << " bytes)" << endl;
+        for (int modeled = 0; modeled < 2; modeled++) {
+            Encoding encoding;
+            encoding.setNumThreads(1);
+            encoding.setContextModeling(modeled);
+            vector<char> compressed, decompressed;
+            double compressBest = -1, decompressBest = -1;
+            for (int round = 0; round < kRounds; round++) {
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                encoding.compress(bytes, data.size(), compressed);
+                double seconds = secondsSince(start);
+                if (compressBest < 0 || seconds < compressBest) compressBest = seconds;
+
+                start = chrono::steady_clock::now();
+                encoding.decompress(&compressed[0], compressed.size(), decompressed);
+                seconds = secondsSince(start);
+                if (decompressBest < 0 || seconds < decompressBest) decompressBest = seconds;
+            }
+            if (decompressed != data) cout << "  (output mismatch!)" << endl;
+            cout << (modeled ? "  order 1: " : "  order 0: ") << compressed.size() << " bytes, compress "
+                 << megabytesPerSecond(data.size(), compressBest) << " MB/s, decompress "
+                 << megabytesPerSecond(data.size(), decompressBest) << " MB/s" << endl;
+        }
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ * File: benchmark.h
+ * -----------------
+ * Throughput benchmarks for the Encoding class.  These are not part of the
+ * interactive program; call them from main when measuring a change.
+ */
+
+#ifndef _benchmark_
+#define _benchmark_
+
+#include <chrono>
+#include <string>
+#include "vector.h"
+
+/*
+ * Function: secondsSince
+ * usage: double seconds = secondsSince(start);
+ * --------------------------------
+ * Returns the wall-clock time elapsed since start, in seconds.  Shared by
+ * the benchmarks, the suite, and the batch commands.
+ */
+double secondsSince(std::chrono::steady_clock::time_point start);
+
+/*
+ * Function: benchmarkDecoders
+ * usage: benchmarkDecoders(files);
+ * --------------------------------
+ * Compresses each file once, then times decompression of the result with
+ * the tree-walking decoder and with the table decoder, printing the best
+ * of several runs for each in megabytes of output per second.  Then does
+ * the same for the table decoder on a copy with interleaved payloads, and
+ * prints how many bytes the interleaving added.
+ */
+void benchmarkDecoders(const Vector<std::string>& files);
+
+/*
+ * Function: benchmarkEncoders
+ * usage: benchmarkEncoders(files);
+ * --------------------------------
+ * Times compression of each file with the string-path encoder and with
+ * the packed codebook encoder, printing the best of several runs for each
+ * in megabytes of input per second.
+ */
+void benchmarkEncoders(const Vector<std::string>& files);
+
+/*
+ * Function: benchmarkHistogram
+ * usage: benchmarkHistogram(files);
+ * --------------------------------
+ * Times counting the bytes of each file with a Map, as compress used to,
+ * and with countBytes, printing the best of several runs for each in
+ * megabytes of input per second.
+ */
+void benchmarkHistogram(const Vector<std::string>& files);
+
+/*
+ * Function: reportCodeLengthLimits
+ * usage: reportCodeLengthLimits(files);
+ * --------------------------------
+ * Compresses each file with every code length limit from 11 to 15 bits
+ * and with no practical limit, printing the compressed sizes and how much
+ * larger each limited result is than the unlimited one.
+ */
+void reportCodeLengthLimits(const Vector<std::string>& files);
+
+/*
+ * Function: benchmarkMappedInput
+ * usage: benchmarkMappedInput(files);
+ * --------------------------------
+ * Times compression and decompression of each file with the input opened
+ * as an ordinary stream and with it mapped into memory, on one thread,
+ * printing the best of several runs for each in megabytes of uncompressed
+ * data per second.
+ */
+void benchmarkMappedInput(const Vector<std::string>& files);
+
+/*
+ * Function: benchmarkThreads
+ * usage: benchmarkThreads(files, 8);
+ * --------------------------------
+ * Times compression and decompression of each file with 1 through
+ * maxThreads threads, printing the best of several runs for each thread
+ * count in megabytes of uncompressed data per second, along with the
+ * speedup over one thread.  Use files of many blocks; a file smaller than
+ * one block cannot be split between threads.
+ */
+void benchmarkThreads(const Vector<std::string>& files, int maxThreads);
+
+/*
+ * Function: benchmarkLevels
+ * usage: benchmarkLevels(files);
+ * --------------------------------
+ * Compresses and decompresses each file in memory at every compression
+ * level on one thread, printing the compressed size as a share of the
+ * original and the best of several runs for each direction in megabytes
+ * of uncompressed data per second.
+ */
+void benchmarkLevels(const Vector<std::string>& files);
+
+/*
+ * Function: benchmarkAdaptive
+ * usage: benchmarkAdaptive(files);
+ * --------------------------------
+ * Compares the adaptive coder with Encoding on short messages taken from
+ * the start of each file, from 16 bytes to 4 KiB.  For each size it prints
+ * both output sizes, the time until the first byte of output is ready, and
+ * the time until the decoder hands back the first character, averaged over
+ * many runs: for Encoding those are when compress and decompress return,
+ * and for the adaptive coder, fed one character or one byte at a time,
+ * they are as soon as something comes out.  Both outputs are decoded and
+ * checked against the message.
+ */
+void benchmarkAdaptive(const Vector<std::string>& files);
+
+/*
+ * Function: benchmarkRangeReads
+ * usage: benchmarkRangeReads(files);
+ * --------------------------------
+ * Compresses each file with block sizes from 16 KiB to 1 MiB, and for each
+ * prints the compressed size and the average time of reading 100 bytes at
+ * random offsets from the mapped file with decompressRange.
+ */
+void benchmarkRangeReads(const Vector<std::string>& files);
+
+/*
+ * Function: benchmarkContexts
+ * usage: benchmarkContexts(files);
+ * --------------------------------
+ * Compresses each file in memory on one thread with and without context
+ * modeling, printing the compressed sizes and the best of several runs for
+ * each direction in megabytes of uncompressed data per second, so that the
+ * space saved can be weighed against the slower decoding.
+ */
+void benchmarkContexts(const Vector<std::string>& files);
+
+#endif
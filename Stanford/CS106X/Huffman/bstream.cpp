@@ -1,7 +1,8 @@
 /**
  * File: bstream.cpp
  * -----------------
- * Implementation of ibstream and obstream classes.  These classes are patterned after
+ * Implementation of the BitReader and BitWriter classes, and of the ibstream and
+ * obstream classes.  The stream classes are patterned after
  * (and, in fact, inherit from) the standard ifstream and ofstream classes.  Please
  * see bstream.h for information about how a client properly uses these classes.
  *
@@ -11,13 +12,119 @@
 #include <iostream>
 #include "bstream.h"
 #include "error.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
 static const int kNumBitsPerByte = 8;
+static const int kBitBufferSize = 64;    // bits held by the 64-bit buffer
 
 inline int getNthBit(int n, int fromByte) { return ((fromByte & (1 << n)) != 0) ? 1 : 0; }
 inline void setNthBit(int n, int& inByte) { inByte |= (1 << n); }
 
+/**
+ * Constructor BitReader::BitReader
+ * --------------------------------
+ * The reader starts with an empty bit buffer and reads from data.
+ */
+BitReader::BitReader() : next(NULL), end(NULL), buffer(0), count(0) {}
+
+BitReader::BitReader(const char *data, size_t size) : buffer(0), count(0) {
+	setSource(data, size);
+}
+
+void BitReader::setSource(const char *data, size_t size) {
+	next = (const unsigned char *) data;
+	end = next + size;
+}
+
+/**
+ * Member function BitReader::fill
+ * -------------------------------
+ * Tops the 64-bit buffer up with whole bytes until it holds more than 56
+ * bits.  While eight bytes remain they are gathered as one word, which the
+ * compiler turns into a single load, and only as many of them as fit are
+ * kept.  At the end of the source the buffer is simply left short.
+ */
+void BitReader::fill() {
+	if (end - next >= 8) {
+		uint64_t word = 0;
+		for (int i = 0; i < 8; i++) {
+			word |= uint64_t(next[i]) << (i * kNumBitsPerByte);
+		}
+		int bytes = (kBitBufferSize - count) / kNumBitsPerByte;
+		if (bytes < 8) word &= (uint64_t(1) << (bytes * kNumBitsPerByte)) - 1;
+		buffer |= word << count;
+		next += bytes;
+		count += bytes * kNumBitsPerByte;
+		return;
+	}
+	while (count <= kBitBufferSize - kNumBitsPerByte && next < end) {
+		buffer |= uint64_t(*next++) << count;
+		count += kNumBitsPerByte;
+	}
+}
+
+/**
+ * Function bitsExhaustedError
+ * ---------------------------
+ * Kept out of line so that the inline consume stays small.
+ */
+void bitsExhaustedError() {
+	error("Cannot consume bits past the end of the stream.");
+}
+
+/**
+ * Constructor BitWriter::BitWriter
+ * --------------------------------
+ * The writer starts with an empty bit buffer and appends to bytes, or fills
+ * the memory from data up to data + capacity.
+ */
+BitWriter::BitWriter(vector<char>& bytes) : bytes(&bytes), next(NULL), end(NULL),
+                                            buffer(0), count(0) {}
+
+BitWriter::BitWriter(char *data, size_t capacity) : bytes(NULL), next(data), end(data + capacity),
+                                                    buffer(0), count(0) {}
+
+/**
+ * Member function BitWriter::drain
+ * --------------------------------
+ * Moves the whole bytes in the 64-bit buffer out to memory.  Leaves fewer
+ * than 8 bits behind.
+ */
+void BitWriter::drain() {
+	while (count >= kNumBitsPerByte) {
+		char byte = char(buffer & 0xFF);
+		if (bytes != NULL) {
+			bytes->push_back(byte);
+		} else {
+			if (next == end) error("Cannot write bits past the end of the buffer.");
+			*next++ = byte;
+		}
+		buffer >>= kNumBitsPerByte;
+		count -= kNumBitsPerByte;
+	}
+}
+
+/**
+ * Member function BitWriter::flush
+ * --------------------------------
+ * Drains the buffer and rounds a partial byte up to a whole one.
+ */
+void BitWriter::flush() {
+	drain();
+	if (count > 0) {
+		count = kNumBitsPerByte;
+		drain();
+	}
+	buffer = 0;
+	count = 0;
+}
+
 /**
  * Constructor ibstream::ibstream
  * ------------------------------
@@ -29,7 +136,17 @@ inline void setNthBit(int n, int& inByte) { inByte |= (1 << n); }
  * We set initial state for lastTell and curByte to 0, then pos is
  * set at 8 so that next readbit will trigger a fresh read.
  */
-ibstream::ibstream() : lastTell(0), curByte(0), pos(kNumBitsPerByte) {}
+ibstream::ibstream() : lastTell(0), curByte(0), pos(kNumBitsPerByte),
+                       mapped(false), mapData(NULL), mapSize(0) {}
+
+/**
+ * Destructor ibstream::~ibstream
+ * ------------------------------
+ * Makes sure a mapping does not outlive the stream.
+ */
+ibstream::~ibstream() {
+	unmap();
+}
 
 /**
  * Member function ibstream::open
@@ -41,6 +158,71 @@ void ibstream::open(const char * filename) {
 	ifstream::open(filename, ios::binary);
 }
 
+/**
+ * Member function ibstream::openMapped
+ * ------------------------------------
+ * Opens the stream as usual, then maps the file with its own descriptor, which
+ * can be closed as soon as the mapping exists.  An empty file has nothing to map
+ * but still counts as mapped.  Where mmap is not available the file is read into
+ * memory instead, which gives callers the same view of it.
+ */
+void ibstream::openMapped(const char * filename) {
+	unmap();
+	open(filename);
+	if (fail()) return;
+#ifndef _WIN32
+	int fd = ::open(filename, O_RDONLY);
+	if (fd < 0) return;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+		if (info.st_size == 0) {
+			mapped = true;
+		} else {
+			void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				madvise(data, info.st_size, MADV_SEQUENTIAL);
+				mapped = true;
+				mapData = (const char *) data;
+				mapSize = info.st_size;
+			}
+		}
+	}
+	::close(fd);
+#else
+	mapCopy.resize(size());
+	if (!mapCopy.empty()) read(&mapCopy[0], mapCopy.size());
+	rewind();
+	mapped = true;
+	mapData = mapCopy.empty() ? NULL : &mapCopy[0];
+	mapSize = mapCopy.size();
+#endif
+}
+
+/**
+ * Member function ibstream::close
+ * -------------------------------
+ * Unmaps, then closes as ifstream would.
+ */
+void ibstream::close() {
+	unmap();
+	ifstream::close();
+}
+
+/**
+ * Member function ibstream::unmap
+ * -------------------------------
+ * Releases the mapping made by openMapped, if there is one.
+ */
+void ibstream::unmap() {
+#ifndef _WIN32
+	if (mapData != NULL) munmap((void *) mapData, mapSize);
+#endif
+	vector<char>().swap(mapCopy);
+	mapped = false;
+	mapData = NULL;
+	mapSize = 0;
+}
+
 /**
  * Member function ibstream::readbit
  * ---------------------------------
@@ -84,6 +266,7 @@ void ibstream::rewind() {
  */
 long ibstream::size() {
 	if (!is_open()) error("Cannot get size of stream which is not open.");
+	if (mapped) return long(mapSize);
 	clear();					// clear any error state
 	streampos cur = tellg();	// save current streampos
 	seekg(0, ios::end);			// seek to end
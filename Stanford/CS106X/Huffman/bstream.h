@@ -14,12 +14,145 @@
  * Similarly, the obstream can be used in place of ofstream, and has
  * same operations (open, put, fail, <<, etc.) along with additional
  * member functions writebit and size.
+ *
+ * For bulk bit I/O on blocks of memory, the BitReader and BitWriter classes
+ * move many bits per call (peekBits/consume and writeBits).
  */
  
 #ifndef _bstream_
 #define _bstream_
 
 #include <fstream>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Class: BitReader
+ * ----------------
+ * Reads bits from a block of memory in the order ibstream reads them from a
+ * file: the low bit of each byte comes first.  Bits are moved into a 64-bit
+ * buffer a byte at a time, so peekBits and consume can handle up to 56 bits
+ * per call.  The reader does not own the memory it reads.
+ */
+
+class BitReader {
+public:
+/*
+ * Constructor: BitReader
+ * Usage: BitReader bits(data, size);
+ * ----------------------------------
+ * Initializes a reader for the size bytes at data.  The default
+ * constructor makes a reader with nothing to read.
+ */
+    BitReader();
+    BitReader(const char *data, size_t size);
+
+/*
+ * Member function: setSource
+ * Usage: bits.setSource(data, size);
+ * ----------------------------------
+ * Continues reading from the size bytes at data once the current bytes have
+ * all been moved into the bit buffer.  Bits already buffered are kept.
+ */
+    void setSource(const char *data, size_t size);
+
+/*
+ * Member function: peekBits
+ * Usage: value = bits.peekBits(n);
+ * --------------------------------
+ * Returns the next n bits (0 <= n <= 56) without consuming them, the next
+ * bit in the low bit of the result.  Past the end the missing bits read as 0.
+ */
+    uint64_t peekBits(int n);
+
+/*
+ * Member function: consume
+ * Usage: bits.consume(n);
+ * -----------------------
+ * Skips past n bits (0 <= n <= 56).  Raises an error if fewer than n remain.
+ */
+    void consume(int n);
+
+/*
+ * Member function: fill
+ * Usage: bits.fill();
+ * -------------------
+ * Moves whole bytes into the bit buffer until it holds more than 56 bits or
+ * the source runs out.  peekBits and consume call this as needed.
+ */
+    void fill();
+
+/*
+ * Member function: unreadBytes
+ * Usage: n = bits.unreadBytes();
+ * ------------------------------
+ * Returns the number of whole bytes not yet consumed, counting both the
+ * bit buffer and the rest of the source.
+ */
+    size_t unreadBytes() const;
+
+private:
+    const unsigned char *next, *end;
+    uint64_t buffer;
+    int count;
+};
+
+/*
+ * Class: BitWriter
+ * ----------------
+ * Writes bits to memory in the order obstream writes them to a file.  Bits
+ * collect in a 64-bit buffer and are moved out a byte at a time, either
+ * onto the end of a vector or into a fixed block of memory.
+ */
+
+class BitWriter {
+public:
+/*
+ * Constructor: BitWriter
+ * Usage: BitWriter bits(bytes);
+ *        BitWriter bits(data, capacity);
+ * --------------------------------------
+ * Initializes a writer that appends to bytes, or one that fills the
+ * capacity bytes at data and raises an error if asked to write more.
+ * The memory written to must outlive the writer.
+ */
+    explicit BitWriter(std::vector<char>& bytes);
+    BitWriter(char *data, size_t capacity);
+
+/*
+ * Member function: writeBits
+ * Usage: bits.writeBits(code, length);
+ * ------------------------------------
+ * Appends the low n bits of value (0 <= n <= 64), low bit first.
+ */
+    void writeBits(uint64_t value, int n);
+
+/*
+ * Member function: flush
+ * Usage: bits.flush();
+ * --------------------
+ * Moves everything buffered into the vector, padding a final partial byte
+ * with 0 bits.
+ */
+    void flush();
+
+/*
+ * Member function: drain
+ * Usage: bits.drain();
+ * --------------------
+ * Moves every whole byte buffered into the vector now, leaving fewer than
+ * 8 bits behind.  Writers that hand their output on as it is produced call
+ * this to keep it no more than a byte behind.
+ */
+    void drain();
+
+private:
+    std::vector<char> *bytes;   /* NULL when writing to fixed memory */
+    char *next, *end;
+    uint64_t buffer;
+    int count;
+};
 
 /*
  * Class: ibstream
@@ -50,6 +183,45 @@ public:
  */
 	void open(const char *filename);
 	
+/*
+ * Member function: openMapped
+ * Usage: in.openMapped(name.c_str());
+ * -----------------------------------
+ * Opens the named file as open does and also maps its contents into memory,
+ * read-only, with a hint to the operating system that it will be read
+ * front to back.  The whole file is then available through mappedData
+ * without any reads.  If the file cannot be mapped (a pipe, for example)
+ * the stream is simply left open unmapped; check isMapped.
+ */
+	void openMapped(const char *filename);
+
+/*
+ * Member function: close
+ * Usage: in.close();
+ * ------------------
+ * Releases the mapping, if any, and closes the file.
+ */
+	void close();
+
+/*
+ * Destructor: ~ibstream
+ * Usage: (usually implicit)
+ * -------------------------
+ * Releases the mapping, if any.
+ */
+	~ibstream();
+
+/*
+ * Member functions: isMapped, mappedData, mappedSize
+ * Usage: if (in.isMapped()) process(in.mappedData(), in.mappedSize());
+ * ---------------------------------------------------------------------
+ * Report whether the file was mapped by openMapped, and give the mapped
+ * bytes, which stay valid until the stream is closed.
+ */
+	bool isMapped() const;
+	const char *mappedData() const;
+	size_t mappedSize() const;
+
 /*
  * Member function: readbit
  * Usage: bit = in.readbit();
@@ -74,7 +246,8 @@ public:
  * Member function: size
  * Usage: sz = in.size();
  * ----------------------
- * Returns the size in bytes of the file attached to this stream.
+ * Returns the size in bytes of the file attached to this stream.  A mapped
+ * file knows its size without seeking.
  * Raises an error if this ibstream has not been properly opened.
  */
 	long size();
@@ -82,6 +255,14 @@ public:
 private:
     std::streampos lastTell;
 	int curByte, pos;
+
+    /* state for a mapped file */
+    bool mapped;
+    const char *mapData;
+    size_t mapSize;
+    std::vector<char> mapCopy;  /* holds the file where mmap is not available */
+
+    void unmap();
 };
 
 
@@ -104,7 +285,7 @@ public:
  * open member function from ofstream to attach the stream to a file.
  */
   	obstream();
-  	
+
 /*
  * Member function: open
  * Usage: out.open(name.c_str());
@@ -137,4 +318,53 @@ private:
 	int curByte, pos;
 };
 
-#endif
\ No newline at end of file
+/*
+ * The buffered bit operations are called once per codeword by the Huffman
+ * coder, so they are defined here where the compiler can inline them.  The
+ * slow paths live in bstream.cpp.
+ */
+
+void bitsExhaustedError();
+
+inline uint64_t BitReader::peekBits(int n) {
+    if (count < n) fill();
+    return buffer & ((uint64_t(1) << n) - 1);
+}
+
+inline void BitReader::consume(int n) {
+    if (count < n) {
+        fill();
+        if (count < n) bitsExhaustedError();
+    }
+    buffer >>= n;
+    count -= n;
+}
+
+inline size_t BitReader::unreadBytes() const {
+    return count / 8 + (end - next);
+}
+
+inline void BitWriter::writeBits(uint64_t value, int n) {
+    if (n > 56) {
+        writeBits(value & 0xFFFFFFFF, 32);
+        writeBits(value >> 32, n - 32);
+        return;
+    }
+    if (count + n >= 64) drain();
+    buffer |= (value & ((uint64_t(1) << n) - 1)) << count;
+    count += n;
+}
+
+inline bool ibstream::isMapped() const {
+    return mapped;
+}
+
+inline const char *ibstream::mappedData() const {
+    return mapData;
+}
+
+inline size_t ibstream::mappedSize() const {
+    return mapSize;
+}
+
+#endif
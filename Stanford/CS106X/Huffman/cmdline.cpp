@@ -0,0 +1,36 @@
+/**
+ * File: cmdline.cpp
+ * -----------------
+ * Implementation of the number parsing, on strtol and strtod, with the end
+ * pointer and errno checked so that trailing junk and overflow are errors
+ * rather than silently dropped.
+ */
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include "cmdline.h"
+#include "error.h"
+using namespace std;
+
+int parseInteger(const string& value, const string& what) {
+    const char *start = value.c_str();
+    char *end;
+    errno = 0;
+    long number = strtol(start, &end, 10);
+    if (end == start || *end != '\0' || errno == ERANGE || number < INT_MIN || number > INT_MAX) {
+        error(what + " needs a whole number, not \"" + value + "\".");
+    }
+    return number;
+}
+
+double parseReal(const string& value, const string& what) {
+    const char *start = value.c_str();
+    char *end;
+    errno = 0;
+    double number = strtod(start, &end);
+    if (end == start || *end != '\0' || errno == ERANGE) {
+        error(what + " needs a number, not \"" + value + "\".");
+    }
+    return number;
+}
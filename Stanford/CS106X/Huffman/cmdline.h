@@ -0,0 +1,33 @@
+/**
+ * File: cmdline.h
+ * ---------------
+ * Number parsing for the command-line front ends, batch and suite.  The
+ * library's stringToInteger and stringToReal reject every number on
+ * current C++ libraries, so options and the suite's baseline files are
+ * read with these instead.
+ */
+
+#ifndef _cmdline_
+#define _cmdline_
+
+#include <string>
+
+/*
+ * Function: parseInteger
+ * usage: int level = parseInteger(value, "-l");
+ * --------------------------------
+ * Returns value read as a decimal integer, raising an error that names
+ * what unless all of value is one that fits in an int.
+ */
+int parseInteger(const std::string& value, const std::string& what);
+
+/*
+ * Function: parseReal
+ * usage: double seconds = parseReal(field, "A field of " + filename);
+ * --------------------------------
+ * Returns value read as a floating-point number, raising an error that
+ * names what unless all of value is one.
+ */
+double parseReal(const std::string& value, const std::string& what);
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * File: codebook.cpp
+ * ------------------
+ * Implementation of length-limited code construction and canonical Huffman
+ * code assignment.
+ */
+
+#include <algorithm>
+#include <vector>
+#include "codebook.h"
+#include "error.h"
+using namespace std;
+
+/**
+ * Function: limitCodeLengths
+ * --------------------------
+ * Package-merge works on coins: every symbol is a coin at each of the
+ * maxLength levels, worth its count.  Starting from the deepest level, the
+ * coins of each level are paired off cheapest first into packages, and the
+ * packages are merged with the next level's coins in order of worth.  Taking
+ * the 2n - 2 cheapest items at the top level and unpacking them gives each
+ * symbol one unit of length for every level at which one of its coins was
+ * taken.
+ *
+ * Since coins and packages are merged in order of worth, the items taken at
+ * any level are always a prefix of that level's list: the coins among them
+ * are the cheapest symbols, and the packages among them are the first ones,
+ * which were made from a prefix twice as long one level down.  So each level
+ * only needs to remember which of its items are packages, and the unpacking
+ * walks down the levels taking shorter and longer prefixes.
+ */
+void limitCodeLengths(const uint32_t counts[], int maxLength, int lengths[], int numSymbols) {
+    if (maxLength < kMinCodeLengthLimit || maxLength > kMaxCodeLength) {
+        error("Huffman code length limit out of range.");
+    }
+    vector<pair<uint64_t, int> > coins;
+    for (int sym = 0; sym < numSymbols; sym++) {
+        lengths[sym] = 0;
+        if (counts[sym] > 0) coins.push_back(make_pair(uint64_t(counts[sym]), sym));
+    }
+    sort(coins.begin(), coins.end());
+    int n = coins.size();
+    if (n == 0) return;
+    if (n == 1) {
+        lengths[coins[0].second] = 1;
+        return;
+    }
+    if (maxLength < 64 && uint64_t(n) > (uint64_t(1) << maxLength)) {
+        error("Huffman code length limit too short for the alphabet.");
+    }
+
+    /* isPackage[level][i] says whether item i of that level is a package;
+       level maxLength - 1 is the deepest and holds only coins. */
+    vector<vector<bool> > isPackage(maxLength);
+    vector<uint64_t> worth(n), merged;
+    for (int i = 0; i < n; i++) worth[i] = coins[i].first;
+    isPackage[maxLength - 1].assign(n, false);
+    for (int level = maxLength - 2; level >= 0; level--) {
+        merged.clear();
+        int coin = 0;
+        size_t pair = 0;
+        while (coin < n || pair + 1 < worth.size()) {
+            if (pair + 1 >= worth.size() ||
+                (coin < n && coins[coin].first <= worth[pair] + worth[pair + 1])) {
+                merged.push_back(coins[coin++].first);
+                isPackage[level].push_back(false);
+            } else {
+                merged.push_back(worth[pair] + worth[pair + 1]);
+                isPackage[level].push_back(true);
+                pair += 2;
+            }
+        }
+        worth.swap(merged);
+    }
+
+    int taken = 2 * n - 2;
+    for (int level = 0; level < maxLength && taken > 0; level++) {
+        int packages = 0;
+        for (int i = 0; i < taken; i++) {
+            if (isPackage[level][i]) packages++;
+        }
+        for (int i = 0; i < taken - packages; i++) {
+            lengths[coins[i].second]++;
+        }
+        taken = 2 * packages;
+    }
+}
+
+/*
+ * Function: reverseBits
+ * ---------------------
+ * Canonical codes are defined most significant bit first, but codewords
+ * are stored in stream order, so the low length bits are reversed.
+ */
+static uint64_t reverseBits(uint64_t code, int length) {
+    uint64_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    return reversed;
+}
+
+/**
+ * Function: assignCanonicalCodes
+ * ------------------------------
+ * Counts the codes of each length, checks that they do not claim more of the
+ * code space than exists, works out the first code of each length, and then
+ * hands out codes in symbol order.  Runs in time proportional to the alphabet
+ * size plus the longest code.
+ */
+void assignCanonicalCodes(const int lengths[], Codeword codes[], int numSymbols) {
+    int lengthCounts[kMaxCodeLength + 1] = {};
+    for (int sym = 0; sym < numSymbols; sym++) {
+        if (lengths[sym] < 0 || lengths[sym] > kMaxCodeLength) {
+            error("Huffman code length out of range.");
+        }
+        lengthCounts[lengths[sym]]++;
+    }
+    lengthCounts[0] = 0;
+
+    /* available is the number of unused codes of the current length; once it
+       exceeds the alphabet size it can never be used up, so it stops growing. */
+    uint64_t available = 1;
+    for (int length = 1; length <= kMaxCodeLength; length++) {
+        available <<= 1;
+        if (available < uint64_t(lengthCounts[length])) {
+            error("Huffman code lengths do not form a prefix code.");
+        }
+        available -= lengthCounts[length];
+        if (available > uint64_t(numSymbols)) available = numSymbols + 1;
+    }
+
+    uint64_t nextCode[kMaxCodeLength + 1];
+    uint64_t code = 0;
+    nextCode[0] = 0;
+    for (int length = 1; length <= kMaxCodeLength; length++) {
+        code = (code + lengthCounts[length - 1]) << 1;
+        nextCode[length] = code;
+    }
+    for (int sym = 0; sym < numSymbols; sym++) {
+        int length = lengths[sym];
+        codes[sym].length = length;
+        codes[sym].bits = length == 0 ? 0 : reverseBits(nextCode[length]++, length);
+    }
+}
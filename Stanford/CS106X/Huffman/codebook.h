@@ -0,0 +1,73 @@
+/**
+ * File: codebook.h
+ * ----------------
+ * Defines the constants describing the Huffman alphabet, the Codeword
+ * type shared by the encoder and the table-driven decoder, and the
+ * canonical code assignment that lets both sides rebuild a codebook from
+ * nothing but code lengths.
+ */
+
+#ifndef _codebook_
+#define _codebook_
+
+#include <stdint.h>
+
+/*
+ * The alphabet is every byte value plus a pseudo-EOF symbol that marks
+ * the end of the compressed bit stream.
+ */
+const int kNumSymbols = 257;
+const int kPseudoEOF = 256;
+
+/*
+ * Codewords are held in a 64-bit integer, so no code may be longer than
+ * this.  Trees built from 32-bit counts cannot get anywhere near it.
+ */
+const int kMaxCodeLength = 64;
+
+/*
+ * Type: Codeword
+ * --------------
+ * The bit pattern assigned to one symbol.  Bits are stored in stream order:
+ * bit 0 is the first bit written to (and read from) the compressed file,
+ * which matches the order in which bstream packs bits into bytes.  A length
+ * of zero means the symbol does not appear in the codebook.
+ */
+struct Codeword {
+    uint64_t bits;
+    int length;
+};
+
+/*
+ * The shortest length limit limitCodeLengths accepts: every symbol of the
+ * alphabet still gets a code when all codes have this length.
+ */
+const int kMinCodeLengthLimit = 9;
+
+/*
+ * Function: limitCodeLengths
+ * usage: limitCodeLengths(counts, maxLength, lengths);
+ * ----------------------------------------------------
+ * Replaces lengths with the code lengths that give the smallest output for
+ * the numSymbols counts among codes no longer than maxLength bits, using
+ * the package-merge algorithm.  Symbols with a count of zero get length
+ * zero.  maxLength must be between kMinCodeLengthLimit and kMaxCodeLength,
+ * and long enough for the number of symbols used.
+ */
+void limitCodeLengths(const uint32_t counts[], int maxLength, int lengths[],
+                      int numSymbols = kNumSymbols);
+
+/*
+ * Function: assignCanonicalCodes
+ * usage: assignCanonicalCodes(lengths, codes);
+ * --------------------------------------------
+ * Fills codes with the canonical Huffman code for the numSymbols code
+ * lengths given.  Shorter codes come first, and codes of equal length are
+ * consecutive binary numbers in symbol order, so the lengths alone
+ * determine every codeword.  Raises an error if the lengths are out of
+ * range or too short to form a prefix code.  The byte alphabet is the
+ * default; the LZ77 stage codes larger and smaller ones.
+ */
+void assignCanonicalCodes(const int lengths[], Codeword codes[], int numSymbols = kNumSymbols);
+
+#endif
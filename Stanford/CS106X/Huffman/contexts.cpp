@@ -0,0 +1,207 @@
+/**
+ * File: contexts.cpp
+ * ------------------
+ * Implementation of context counting and grouping.
+ *
+ * Grouping is greedy and bottom-up.  Every context starts out as a group of
+ * its own, except the rarely seen ones, which start out together, and the
+ * pair of groups whose merge saves the most is merged until no merge saves
+ * anything.  A group's cost is the entropy of its counts, which is close to
+ * what its Huffman code will spend, plus the size of its code table.  The
+ * cost of merging every pair is kept in a matrix, so a merge only has to
+ * recompute the row of the group it grew.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "contexts.h"
+using namespace std;
+
+static const uint32_t kMinOwnCount = 64;    /* rarer contexts start out in one shared group */
+static const int kMaxOwnGroups = 64;        /* and so do all but this many of the most common */
+static const int kLogTableSize = 1 << 16;   /* counts below this have their n log n looked up */
+
+/*
+ * The values of n log2 n for small n, filled in before main runs.  Floats
+ * are precise enough to rank merges and keep the table small.
+ */
+struct LogTable {
+    float values[kLogTableSize];
+
+    LogTable() {
+        values[0] = 0;
+        for (int n = 1; n < kLogTableSize; n++) {
+            values[n] = float(n * log2(double(n)));
+        }
+    }
+};
+
+static const LogTable kLogTable;
+
+/*
+ * Function: nLogN
+ * ---------------
+ * Returns n log2 n, which is 0 for n = 0.
+ */
+static inline double nLogN(uint32_t n) {
+    return n < uint32_t(kLogTableSize) ? kLogTable.values[n] : n * log2(double(n));
+}
+
+/*
+ * Function: groupCost
+ * -------------------
+ * Returns the estimated bits taken by a group with the given counts: its
+ * entropy, total log2 total minus the sum of n log2 n over the counts, and
+ * its code table.
+ */
+static double groupCost(const uint32_t counts[]) {
+    uint32_t total = 0;
+    int used = 0;
+    double sum = 0;
+    for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+        if (counts[symbol] == 0) continue;
+        total += counts[symbol];
+        used++;
+        sum += nLogN(counts[symbol]);
+    }
+    return nLogN(total) - sum + kNumSymbols + kContextLengthBits * used;
+}
+
+/*
+ * Function: mergedCost
+ * --------------------
+ * Returns groupCost of the sum of two groups' counts.
+ */
+static double mergedCost(const uint32_t one[], const uint32_t two[]) {
+    uint32_t merged[kNumSymbols];
+    for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+        merged[symbol] = one[symbol] + two[symbol];
+    }
+    return groupCost(merged);
+}
+
+/**
+ * Function: countContexts
+ * -----------------------
+ * The previous character picks the row, so consecutive increments land in
+ * different rows and rarely wait on each other.
+ */
+void countContexts(const char *data, int size, uint32_t counts[]) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    int previous = 0;
+    for (int i = 0; i < size; i++) {
+        counts[previous * kNumSymbols + bytes[i]]++;
+        previous = bytes[i];
+    }
+    counts[previous * kNumSymbols + kPseudoEOF]++;
+}
+
+int groupContexts(const uint32_t counts[], int maxGroups, uint8_t groups[]) {
+    /*
+     * Start with a group for each context that is common enough, and one for
+     * the rest.  Merging costs the square of the number of groups, so at most
+     * kMaxOwnGroups contexts count as common.
+     */
+    vector<uint32_t> totals(kNumContexts, 0);
+    for (int context = 0; context < kNumContexts; context++) {
+        const uint32_t *row = counts + context * kNumSymbols;
+        for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+            totals[context] += row[symbol];
+        }
+    }
+    vector<uint32_t> ranked(totals);
+    nth_element(ranked.begin(), ranked.begin() + kMaxOwnGroups - 1, ranked.end(), greater<uint32_t>());
+    uint32_t minOwnCount = max(kMinOwnCount, ranked[kMaxOwnGroups - 1]);
+    vector<vector<uint32_t> > groupCounts;
+    vector<int> groupOf(kNumContexts, -1);
+    int rare = -1;
+    int ownGroups = 0;
+    for (int context = 0; context < kNumContexts; context++) {
+        const uint32_t *row = counts + context * kNumSymbols;
+        uint32_t total = totals[context];
+        if (total == 0) continue;
+        int group;
+        if (total >= minOwnCount && ownGroups < kMaxOwnGroups) {
+            group = groupCounts.size();
+            groupCounts.push_back(vector<uint32_t>(kNumSymbols, 0));
+            ownGroups++;
+        } else {
+            if (rare < 0) {
+                rare = groupCounts.size();
+                groupCounts.push_back(vector<uint32_t>(kNumSymbols, 0));
+            }
+            group = rare;
+        }
+        for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+            groupCounts[group][symbol] += row[symbol];
+        }
+        groupOf[context] = group;
+    }
+    int n = groupCounts.size();
+    if (n == 0) {
+        fill(groups, groups + kNumContexts, 0);
+        return 1;
+    }
+
+    /* savings[i * n + j], for i < j, is what merging groups i and j saves. */
+    vector<double> cost(n);
+    for (int i = 0; i < n; i++) {
+        cost[i] = groupCost(&groupCounts[i][0]);
+    }
+    vector<double> savings(n * n);
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            savings[i * n + j] = cost[i] + cost[j] - mergedCost(&groupCounts[i][0], &groupCounts[j][0]);
+        }
+    }
+    vector<bool> alive(n, true);
+    vector<int> mergedInto(n);
+    for (int i = 0; i < n; i++) {
+        mergedInto[i] = i;
+    }
+    int remaining = n;
+    while (remaining > 1) {
+        int bestI = -1, bestJ = -1;
+        for (int i = 0; i < n; i++) {
+            if (!alive[i]) continue;
+            for (int j = i + 1; j < n; j++) {
+                if (alive[j] && (bestI < 0 || savings[i * n + j] > savings[bestI * n + bestJ])) {
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+        if (remaining <= maxGroups && savings[bestI * n + bestJ] <= 0) break;
+        for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+            groupCounts[bestI][symbol] += groupCounts[bestJ][symbol];
+        }
+        cost[bestI] = groupCost(&groupCounts[bestI][0]);
+        alive[bestJ] = false;
+        mergedInto[bestJ] = bestI;
+        remaining--;
+        for (int k = 0; k < n; k++) {
+            if (!alive[k] || k == bestI) continue;
+            int i = min(k, bestI), j = max(k, bestI);
+            savings[i * n + j] = cost[i] + cost[j] - mergedCost(&groupCounts[i][0], &groupCounts[j][0]);
+        }
+    }
+
+    /* Number the surviving groups in order and point each context at its group. */
+    vector<int> number(n, -1);
+    int numGroups = 0;
+    for (int i = 0; i < n; i++) {
+        if (alive[i]) number[i] = numGroups++;
+    }
+    for (int context = 0; context < kNumContexts; context++) {
+        int group = groupOf[context];
+        if (group < 0) {
+            groups[context] = 0;
+            continue;
+        }
+        while (mergedInto[group] != group) group = mergedInto[group];
+        groups[context] = number[group];
+    }
+    return numGroups;
+}
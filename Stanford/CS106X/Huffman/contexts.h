@@ -0,0 +1,51 @@
+/**
+ * File: contexts.h
+ * ----------------
+ * Defines the order-1 statistics behind Encoding's context-modeled blocks.
+ * In such a block each character is coded with a code chosen by the
+ * character before it, its context.  A code for each of the 256 contexts
+ * would cost more to store than it saves, so contexts whose characters
+ * follow similar distributions are grouped and share one code.
+ */
+
+#ifndef _contexts_
+#define _contexts_
+
+#include <stdint.h>
+#include "codebook.h"
+
+/* One context for each value of the previous character. */
+const int kNumContexts = 256;
+
+/* The most groups a block may have. */
+const int kMaxContextGroups = 16;
+
+/* Bits used to store each code length in a context-modeled block. */
+const int kContextLengthBits = 4;
+
+/*
+ * Function: countContexts
+ * usage: countContexts(data, size, counts);
+ * -----------------------------------------
+ * Counts each character of the size characters at data, and a pseudo-EOF
+ * after the last, in the context of the character before it; the first
+ * character's context is 0.  counts holds kNumContexts rows of kNumSymbols
+ * entries, one row per context, and the counts are added to it.
+ */
+void countContexts(const char *data, int size, uint32_t counts[]);
+
+/*
+ * Function: groupContexts
+ * usage: int numGroups = groupContexts(counts, maxGroups, groups);
+ * ----------------------------------------------------------------
+ * Sorts the contexts counted in counts into at most maxGroups groups,
+ * storing each context's group in groups, and returns the number of
+ * groups.  Groups are merged for as long as a merge makes the estimated
+ * size of the payload and code tables smaller, and then until there are
+ * no more than maxGroups.  Contexts that never occur are put in group 0.
+ * The table size assumed is one presence bit for each symbol and
+ * kContextLengthBits for each symbol used.
+ */
+int groupContexts(const uint32_t counts[], int maxGroups, uint8_t groups[]);
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * File: corpus.cpp
+ * ----------------
+ * Implementation of the corpus generator.  Random numbers come from
+ * mt19937_64, whose output the standard fixes exactly; everything drawn
+ * from them is computed here.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "corpus.h"
+#include "error.h"
+#include "filelib.h"
+#include "lexicon.h"
+#include "foreach.h"
+using namespace std;
+
+static const double kZipfExponent = 1.0;
+static const int kFirstPrintable = ' ';
+static const int kLastPrintable = '~';
+static const int kMinWordsPerLine = 6;
+static const int kMaxWordsPerLine = 14;
+static const int kRawWordChance = 8;        /* one binary field in this many is raw random bits */
+static const int kPaddingChance = 16;       /* one binary field in this many is a run of zeros */
+static const int kMaxPadding = 256;
+
+/*
+ * Function: unitInterval
+ * ----------------------
+ * Returns a double in [0, 1) built from the top 53 bits of a random number.
+ */
+static double unitInterval(mt19937_64& random) {
+    return (random() >> 11) * (1.0 / (uint64_t(1) << 53));
+}
+
+/*
+ * Function: below
+ * ---------------
+ * Returns a random number from 0 to n - 1.  The slight bias of taking a
+ * remainder does not matter for test data.
+ */
+static inline uint64_t below(mt19937_64& random, uint64_t n) {
+    return random() % n;
+}
+
+/*
+ * Class: ZipfTable
+ * ----------------
+ * Draws ranks from 0 to n - 1 with probability proportional to
+ * 1 / (rank + 1)^kZipfExponent, by binary search of the cumulative
+ * probabilities.
+ */
+class ZipfTable {
+public:
+    explicit ZipfTable(size_t n) : cumulative(n) {
+        double total = 0;
+        for (size_t rank = 0; rank < n; rank++) {
+            total += 1.0 / pow(double(rank + 1), kZipfExponent);
+            cumulative[rank] = total;
+        }
+        for (size_t rank = 0; rank < n; rank++) {
+            cumulative[rank] /= total;
+        }
+    }
+
+    size_t draw(mt19937_64& random) const {
+        size_t rank = upper_bound(cumulative.begin(), cumulative.end(), unitInterval(random))
+                      - cumulative.begin();
+        return min(rank, cumulative.size() - 1);
+    }
+
+private:
+    vector<double> cumulative;
+};
+
+string corpusName(CorpusKind kind) {
+    switch (kind) {
+        case UNIFORM_CORPUS: return "uniform";
+        case ZIPF_CORPUS: return "zipf";
+        case ENGLISH_CORPUS: return "english";
+        case BINARY_CORPUS: return "binary";
+    }
+    return "";
+}
+
+CorpusGenerator::CorpusGenerator(uint64_t seed) {
+    this->seed = seed;
+}
+
+/**
+ * Method: loadWords
+ * -----------------
+ * The lexicon lists its words alphabetically, so they are shuffled before
+ * being ranked; otherwise the words starting with "a" would be the common
+ * ones.
+ */
+void CorpusGenerator::loadWords(const string& filename) {
+    if (!fileExists(filename)) error("Cannot find " + filename + ".");
+    Lexicon lexicon(filename);
+    words.clear();
+    foreach (string word in lexicon) {
+        words.push_back(word);
+    }
+    if (words.empty()) error(filename + " has no words.");
+    mt19937_64 random(seed);
+    for (size_t i = words.size() - 1; i > 0; i--) {
+        swap(words[i], words[below(random, i + 1)]);
+    }
+}
+
+/**
+ * Method: generate
+ * ----------------
+ * Each kind seeds its own stream from the generator's seed and the kind.
+ * Text is built a word or field at a time and cut off at size.
+ */
+void CorpusGenerator::generate(CorpusKind kind, size_t size, vector<char>& out) {
+    mt19937_64 random(seed * kNumCorpusKinds + kind);
+    out.clear();
+    out.reserve(size);
+    switch (kind) {
+    case UNIFORM_CORPUS:
+        while (out.size() < size) {
+            uint64_t bits = random();
+            for (int i = 0; i < 8 && out.size() < size; i++, bits >>= 8) {
+                out.push_back(char(bits));
+            }
+        }
+        break;
+
+    case ZIPF_CORPUS: {
+        const int numCharacters = kLastPrintable - kFirstPrintable + 2;   /* and newline */
+        char characters[numCharacters];
+        for (int i = 0; i < numCharacters - 1; i++) {
+            characters[i] = char(kFirstPrintable + i);
+        }
+        characters[numCharacters - 1] = '\n';
+        for (int i = numCharacters - 1; i > 0; i--) {
+            swap(characters[i], characters[below(random, i + 1)]);
+        }
+        ZipfTable ranks(numCharacters);
+        while (out.size() < size) {
+            out.push_back(characters[ranks.draw(random)]);
+        }
+        break;
+    }
+
+    case ENGLISH_CORPUS: {
+        if (words.empty()) error("Call loadWords before generating English.");
+        ZipfTable ranks(words.size());
+        while (out.size() < size) {
+            int lineWords = kMinWordsPerLine + below(random, kMaxWordsPerLine - kMinWordsPerLine + 1);
+            for (int i = 0; i < lineWords; i++) {
+                const string& word = words[ranks.draw(random)];
+                out.insert(out.end(), word.begin(), word.end());
+                out.push_back(i + 1 < lineWords ? ' ' : '\n');
+            }
+        }
+        out.resize(size);
+        break;
+    }
+
+    case BINARY_CORPUS:
+        while (out.size() < size) {
+            if (below(random, kPaddingChance) == 0) {
+                out.insert(out.end(), 1 + below(random, kMaxPadding), 0);
+                continue;
+            }
+            uint32_t field = uint32_t(random());
+            if (below(random, kRawWordChance) != 0) {
+                field >>= below(random, 32);        /* mostly small values */
+            }
+            for (int i = 0; i < 4; i++, field >>= 8) {
+                out.push_back(char(field));
+            }
+        }
+        out.resize(size);
+        break;
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * File: corpus.h
+ * --------------
+ * Defines CorpusGenerator, which makes the test data for the benchmark
+ * suite.  The same seed always gives the same bytes, on any machine, so
+ * results can be compared with ones recorded earlier or elsewhere.
+ */
+
+#ifndef _corpus_
+#define _corpus_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Type: CorpusKind
+ * ----------------
+ * The kinds of data generated.  UNIFORM_CORPUS is random bytes, which do
+ * not compress.  ZIPF_CORPUS is printable text whose character frequencies
+ * fall off as 1/rank, giving long codes for the rare ones.  ENGLISH_CORPUS
+ * is lines of words from a lexicon, the common ones far more often than
+ * the rest.  BINARY_CORPUS looks like the data sections of a binary file:
+ * little-endian integers, mostly small, with runs of zero padding.
+ */
+enum CorpusKind { UNIFORM_CORPUS, ZIPF_CORPUS, ENGLISH_CORPUS, BINARY_CORPUS };
+const int kNumCorpusKinds = 4;
+
+/*
+ * Function: corpusName
+ * usage: string name = corpusName(kind);
+ * --------------------------------------
+ * Returns a short lowercase name for kind, for labelling results.
+ */
+std::string corpusName(CorpusKind kind);
+
+/*
+ * Class: CorpusGenerator
+ * ----------------------
+ * Generates data of each kind from a seed.  Each kind has its own random
+ * stream, started afresh for every call, so a shorter corpus is always
+ * the start of a longer one of the same kind.  Only the generator's own
+ * arithmetic is used on the random numbers, not the standard library's
+ * distributions, which differ from one library to another.
+ */
+class CorpusGenerator {
+public:
+    /*
+     * Constructor: CorpusGenerator(seed)
+     * usage: CorpusGenerator generator(1);
+     * --------------------------------
+     * Creates a generator for the given seed.
+     */
+    explicit CorpusGenerator(uint64_t seed);
+
+    /*
+     * Method: loadWords
+     * usage: generator.loadWords("EnglishWords.dat");
+     * --------------------------------
+     * Reads the words for ENGLISH_CORPUS from a lexicon file.  Raises an
+     * error if the file cannot be read.
+     */
+    void loadWords(const std::string& filename);
+
+    /*
+     * Method: generate
+     * usage: generator.generate(ZIPF_CORPUS, 1 << 20, data);
+     * --------------------------------
+     * Replaces the contents of out with size bytes of the given kind.
+     * ENGLISH_CORPUS needs loadWords to have been called first.
+     */
+    void generate(CorpusKind kind, size_t size, std::vector<char>& out);
+
+private:
+    uint64_t seed;
+    std::vector<std::string> words;     /* shuffled, most common first */
+};
+
+#endif
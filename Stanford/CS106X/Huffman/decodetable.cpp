@@ -0,0 +1,114 @@
+/**
+ * File: decodetable.cpp
+ * ---------------------
+ * Implementation of the DecodeTable class.
+ */
+
+#include <algorithm>
+#include "decodetable.h"
+using namespace std;
+
+static const uint64_t kNoBits = 0;
+
+/*
+ * Function: remainingBits
+ * -----------------------
+ * Returns the bits of code that follow the first consumed bits.
+ */
+static inline uint64_t remainingBits(const Codeword& code, int consumed) {
+    return consumed < 64 ? code.bits >> consumed : kNoBits;
+}
+
+DecodeTable::DecodeTable() {}
+
+/**
+ * Method: build
+ * -------------
+ * Starts from a primary table in which every slot is invalid, fills it with
+ * all the codes present in the codebook, then pairs up short codes.
+ */
+void DecodeTable::build(const Codeword codes[], int numSymbols, bool pairSymbols) {
+    Entry invalid = {0, 0, 0, 0};
+    table.assign(size_t(1) << kTableBits, invalid);
+    vector<int> symbols;
+    for (int sym = 0; sym < numSymbols; sym++) {
+        if (codes[sym].length > 0) symbols.push_back(sym);
+    }
+    fill(0, kTableBits, symbols, codes, 0);
+    if (pairSymbols) pairPrimaryEntries();
+}
+
+/**
+ * Method: fill
+ * ------------
+ * Fills the width-bit table starting at base with the given symbols, whose
+ * first consumed bits have already been matched on the way to this table.
+ * Codes that end within this table are replicated into every slot sharing
+ * their prefix.  The others are grouped by their next width bits, and each
+ * group gets its own subtable, just wide enough for the longest code in it
+ * (up to kTableBits), which is filled recursively.
+ */
+void DecodeTable::fill(size_t base, int width, const vector<int>& symbols,
+                       const Codeword codes[], int consumed) {
+    uint64_t mask = (uint64_t(1) << width) - 1;
+    vector<pair<uint64_t, int> > longer;
+    for (size_t i = 0; i < symbols.size(); i++) {
+        int sym = symbols[i];
+        int rest = codes[sym].length - consumed;
+        uint64_t bits = remainingBits(codes[sym], consumed);
+        if (rest <= width) {
+            Entry leaf = {uint32_t(sym), 1, uint8_t(rest), 0};
+            for (uint64_t high = 0; high < (uint64_t(1) << (width - rest)); high++) {
+                table[base + (bits | (high << rest))] = leaf;
+            }
+        } else {
+            longer.push_back(make_pair(bits & mask, sym));
+        }
+    }
+    sort(longer.begin(), longer.end());
+    size_t start = 0;
+    while (start < longer.size()) {
+        size_t end = start;
+        int longest = 0;
+        vector<int> group;
+        while (end < longer.size() && longer[end].first == longer[start].first) {
+            group.push_back(longer[end].second);
+            longest = max(longest, codes[longer[end].second].length - consumed - width);
+            end++;
+        }
+        int subBits = min(longest, int(kTableBits));
+        size_t offset = table.size();
+        Entry invalid = {0, 0, 0, 0};
+        table.resize(offset + (size_t(1) << subBits), invalid);
+        Entry link = {uint32_t(offset), 0, uint8_t(width), uint8_t(subBits)};
+        table[base + longer[start].first] = link;
+        fill(offset, subBits, group, codes, consumed + width);
+        start = end;
+    }
+}
+
+/**
+ * Method: pairPrimaryEntries
+ * --------------------------
+ * For each primary slot holding a single code shorter than kTableBits, looks
+ * at the slot addressed by the bits that follow it.  If that slot is also a
+ * single code and the two codes fit in kTableBits together, the second code
+ * does not depend on any bits beyond the index, so both symbols can be
+ * resolved by this slot.  Nothing is paired behind the pseudo-EOF, since no
+ * bits after it are meaningful, or behind the match symbols that follow it
+ * in the LZ77 alphabet, which are followed by extra bits.
+ */
+void DecodeTable::pairPrimaryEntries() {
+    size_t primarySize = size_t(1) << kTableBits;
+    vector<Entry> singles(table.begin(), table.begin() + primarySize);
+    for (size_t i = 0; i < primarySize; i++) {
+        const Entry& first = singles[i];
+        if (first.count != 1 || first.value >= uint32_t(kPseudoEOF)) continue;
+        if (first.bits >= kTableBits) continue;
+        const Entry& second = singles[i >> first.bits];
+        if (second.count != 1 || first.bits + second.bits > kTableBits) continue;
+        table[i].value = first.value | (second.value << 16);
+        table[i].count = 2;
+        table[i].bits = uint8_t(first.bits + second.bits);
+    }
+}
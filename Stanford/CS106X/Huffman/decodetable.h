@@ -0,0 +1,91 @@
+/**
+ * File: decodetable.h
+ * -------------------
+ * Defines the DecodeTable class, a flattened lookup table that lets the
+ * decompressor resolve whole codewords from a bit buffer instead of
+ * walking the encoding tree one bit at a time.
+ */
+
+#ifndef _decodetable_
+#define _decodetable_
+
+#include <vector>
+#include "codebook.h"
+
+/*
+ * Class: DecodeTable
+ * ------------------
+ * The table is indexed by the next kTableBits bits of the stream (in stream
+ * order, so the next bit to read is the low bit of the index).  Codes that
+ * fit in the primary table are replicated into every slot that shares their
+ * prefix; longer codes are resolved through secondary tables linked from the
+ * primary slot of their first kTableBits bits, nesting as deep as needed.
+ * Where two short codes fit in kTableBits together, the primary entry holds
+ * both symbols so that a single probe resolves two symbols.  Symbols from
+ * kPseudoEOF up are never the first of a pair, since what follows them in
+ * the stream is not another code from the same table.
+ */
+class DecodeTable {
+public:
+    /* Width in bits of the primary table and the widest secondary table. */
+    static const int kTableBits = 11;
+
+    /*
+     * Type: Entry
+     * -----------
+     * count is the number of symbols the entry resolves: 1 or 2 for leaf
+     * entries, packed into value as first | second << 16, and bits is the
+     * total length of their codes.  A count of 0 with nonzero subBits is a
+     * link: skip bits bits and index the subtable starting at value with the
+     * next subBits bits.  A count of 0 with subBits 0 marks a bit pattern that
+     * is not a prefix of any codeword.
+     */
+    struct Entry {
+        uint32_t value;
+        uint8_t count;
+        uint8_t bits;
+        uint8_t subBits;
+    };
+
+    /*
+     * Constructor: DecodeTable()
+     * usage: DecodeTable table;
+     * --------------------------------
+     * Initializes an empty table.  Call build before decoding with it.
+     */
+    DecodeTable();
+
+    /*
+     * Method: build
+     * usage: table.build(codes);
+     *        table.build(codes, numSymbols, false);
+     * --------------------------------
+     * Rebuilds the table from an array of numSymbols codewords.  The codes
+     * must form a prefix code; symbols with length zero are left out.  Pass
+     * false for pairSymbols when every code is followed by something other
+     * than another code from this table.
+     */
+    void build(const Codeword codes[], int numSymbols = kNumSymbols, bool pairSymbols = true);
+
+    /*
+     * Method: entries
+     * usage: const DecodeTable::Entry *table = decodeTable.entries();
+     * --------------------------------
+     * Returns the flattened table.  The primary table occupies the first
+     * 1 << kTableBits entries.
+     */
+    const Entry *entries() const;
+
+private:
+    std::vector<Entry> table;
+
+    void fill(size_t base, int width, const std::vector<int>& symbols,
+              const Codeword codes[], int consumed);
+    void pairPrimaryEntries();
+};
+
+inline const DecodeTable::Entry *DecodeTable::entries() const {
+    return &table[0];
+}
+
+#endif
@@ -6,19 +6,134 @@
 
 #include "encoding.h"
 #include "bstream.h"
-#include "map.h"
-#include "foreach.h"
-#include "pqueue.h"
+#include "decodetable.h"
+#include "histogram.h"
+#include "threadpool.h"
 #include "string.h"
 #include "strlib.h"
+#include "error.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
 using namespace std;
 
+static const char kMagic[] = {'H', 'F'}; /* first bytes of every compressed file */
+static const int kFormatVersion = 3;
+static const int kFileHeaderSize = 3;
+static const int kBlockHeaderSize = 8;   /* character count and body size */
+static const int kDefaultBlockSize = 1 << 20; /* characters compressed together with one code */
+static const int kMaxBlockSize = 1 << 30;
+static const int kDefaultMaxCodeLength = 15;
+static const int kBlocksPerThread = 2;   /* blocks in flight for each thread, so workers never wait on I/O */
+static const int kSparseLayout = 0;      /* header lists (character, length) pairs */
+static const int kDenseLayout = 1;       /* header lists the length of every character */
+static const int kMatchLayout = 2;       /* block holds LZ77 tokens rather than characters */
+static const int kContextLayout = 3;     /* block codes each character by the one before it */
+static const int kInterleavedFlag = 0x80; /* set in the layout byte when the payload is split */
+static const int kMaxMatchCodeLength = 15; /* longest code in a matched block */
+static const int kMaxContextCodeLength = (1 << kContextLengthBits) - 1; /* longest code in a context-modeled block */
+static const int kContextGroupBits = 4;  /* bits per entry of a block's context map */
+static const int kMatchLengthBits = 4;   /* bits per code length in a matched block's tables */
+static const int kMatchTablesSize = 1 + (kNumLiteralLengthSymbols + kNumDistanceCodes) * kMatchLengthBits / 8;
+static const char kIndexMagic[] = {'H', 'F', 'I', 'X'}; /* last bytes of every compressed file */
+static const int kFooterSize = 12;       /* index offset and kIndexMagic */
+static const int kIndexEntrySize = 12;   /* block offset and character count */
+
 Encoding::Encoding() {
-    head = NULL;
+    blockSize = kDefaultBlockSize;
+    numThreads = max(1, int(thread::hardware_concurrency()));
+    maxCodeLength = kDefaultMaxCodeLength;
+    level = kMinLevel;
+    interleaved = false;
+    contextModeling = false;
+    encoder = PACKED_CODES;
+    decoder = TABLE_LOOKUP;
 }
 Encoding::~Encoding() {}
 
+/**
+ * Function: setBlockSize
+ * ----------------------
+ * Records the block size compress should use, which must be positive and at
+ * most kMaxBlockSize so that block sizes fit the four-byte header fields.
+ */
+void Encoding::setBlockSize(int bytes) {
+    if (bytes <= 0 || bytes > kMaxBlockSize) error("Block size out of range.");
+    blockSize = bytes;
+}
+
+/**
+ * Function: setNumThreads
+ * -----------------------
+ * Records how many threads compress and decompress may use.
+ */
+void Encoding::setNumThreads(int count) {
+    if (count <= 0) error("Thread count out of range.");
+    numThreads = count;
+}
+
+/**
+ * Function: setMaxCodeLength
+ * --------------------------
+ * Records the code length limit compress should enforce.
+ */
+void Encoding::setMaxCodeLength(int bits) {
+    if (bits < kMinCodeLengthLimit || bits > kMaxCodeLength) error("Code length limit out of range.");
+    maxCodeLength = bits;
+}
+
+/**
+ * Function: setLevel
+ * ------------------
+ * Records the compression level, which must be one MatchFinder accepts.
+ */
+void Encoding::setLevel(int level) {
+    if (level < kMinLevel || level > kMaxLevel) error("Compression level out of range.");
+    this->level = level;
+}
+
+/**
+ * Function: setInterleaved
+ * ------------------------
+ * Records whether compress should split block payloads into streams.
+ */
+void Encoding::setInterleaved(bool enabled) {
+    interleaved = enabled;
+}
+
+/**
+ * Function: setContextModeling
+ * ----------------------------
+ * Records whether compress should try context-modeled blocks.
+ */
+void Encoding::setContextModeling(bool enabled) {
+    contextModeling = enabled;
+}
+
+/**
+ * Function: setEncoder
+ * --------------------
+ * Records which encoding loop compress should use.
+ */
+void Encoding::setEncoder(EncoderKind kind) {
+    encoder = kind;
+}
+
+/**
+ * Function: setDecoder
+ * --------------------
+ * Records which decoding loop decompress should use.
+ */
+void Encoding::setDecoder(DecoderKind kind) {
+    decoder = kind;
+}
+
 /**
  * Function: copy
  * --------------
@@ -39,93 +154,1016 @@ static void copy(ibstream &infile, obstream &outfile) {
  * Function: fillArray
  * -------------------
  * Fills the ith index of an array with the string of bits that will
- * represent the unicode character for i in the compressed file. This
- * is done by recursively traversing the tree, and keeping track of each turn
- * throught the tree.  Going to the left child represents the bit 0, going to the
- * right child represents the bit 1. fillArray is a wrapper function for
- * traverseTree.
+ * represent the unicode character for i in the compressed file, taken
+ * from the canonical codebook.
+ */
+void Encoding::fillArray(const Codeword codes[], string (&array)[257]){
+    for (int letter = 0; letter < kNumSymbols; letter++){
+        array[letter] = "";
+        for (int i = 0; i < codes[letter].length; i++){
+            array[letter] += ((codes[letter].bits >> i) & 1) ? "1" : "0";
+        }
+    }
+}
+
+/**
+ * Function: TreeArena::add
+ * ------------------------
+ * Appends a node to the arena and returns its index.  Only a corrupt codebook can
+ * need more than kMaxNodes nodes.
+ */
+int Encoding::TreeArena::add(int l, int left, int right) {
+    if (size == kMaxNodes) error("Compressed file is corrupt.");
+    letter[size] = l;
+    child[size][0] = left;
+    child[size][1] = right;
+    return size++;
+}
+
+/**
+ * Function: writeByte
+ * -------------------
+ * Writes one code length table byte.  The table goes through the bit writer like
+ * the codes do, so the payload follows it without a gap.
+ */
+static void writeByte(BitWriter &bits, int byte) {
+    bits.writeBits(byte, 8);
+}
+
+/**
+ * Function: readByte
+ * ------------------
+ * Reads one code length table byte, treating the end of the block as an error.
+ */
+static int readByte(BitReader &bits) {
+    int byte = bits.peekBits(8);
+    bits.consume(8);
+    return byte;
+}
+
+/**
+ * Function: storeSize
+ * -------------------
+ * Stores a size in four bytes, least significant first.
+ */
+static void storeSize(char *bytes, uint32_t size) {
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = char(size >> (8 * i));
+    }
+}
+
+/**
+ * Function: loadSize
+ * ------------------
+ * Loads a size stored by storeSize.
  */
-void Encoding::fillArray(LinkedNode* head, string (&array)[257]){
-    string path = "0";
-    traverseTree(head->left, array, path);
-    path = "1";
-    traverseTree(head->right, array, path);
+static uint32_t loadSize(const char *bytes) {
+    uint32_t size = 0;
+    for (int i = 0; i < 4; i++) {
+        size |= uint32_t((unsigned char) bytes[i]) << (8 * i);
+    }
+    return size;
 }
 
 /**
- * Function: traverseTree
+ * Function: appendSize
+ * --------------------
+ * Appends a size to bytes as stored by storeSize.
+ */
+static void appendSize(vector<char>& bytes, uint32_t size) {
+    char stored[4];
+    storeSize(stored, size);
+    bytes.insert(bytes.end(), stored, stored + 4);
+}
+
+/**
+ * Function: appendOffset
  * ----------------------
- * This recursively traverses through the tree.  If it comes to a node that has a value for
- * the letter, it populates the correct index of the array with the bit path
- * taken to get to that node.
+ * Appends a file offset to bytes as eight bytes, least significant first.
  */
-void Encoding::traverseTree(LinkedNode * head, string (&array)[257], string path){
-    if (head->letter < 257){
-        array[head->letter] = path;
-        return;
+static void appendOffset(vector<char>& bytes, uint64_t offset) {
+    appendSize(bytes, uint32_t(offset));
+    appendSize(bytes, uint32_t(offset >> 32));
+}
+
+/**
+ * Function: loadOffset
+ * --------------------
+ * Loads a file offset stored by appendOffset.
+ */
+static uint64_t loadOffset(const char *bytes) {
+    return loadSize(bytes) | uint64_t(loadSize(bytes + 4)) << 32;
+}
+
+/**
+ * Function: readFully
+ * -------------------
+ * Reads exactly size bytes, treating a short read as a truncated file.
+ */
+static void readFully(ibstream &infile, char *bytes, long size) {
+    infile.read(bytes, size);
+    if (infile.gcount() != size) error("Compressed file is truncated.");
+}
+
+/**
+ * Function: storeFileHeader
+ * -------------------------
+ * Stores the magic bytes and the format version that start every compressed file.
+ */
+static void storeFileHeader(char *bytes) {
+    bytes[0] = kMagic[0];
+    bytes[1] = kMagic[1];
+    bytes[2] = kFormatVersion;
+}
+
+/**
+ * Function: checkFileHeader
+ * -------------------------
+ * Checks the magic bytes and version stored by storeFileHeader.
+ */
+static void checkFileHeader(const char *bytes) {
+    if (bytes[0] != kMagic[0] || bytes[1] != kMagic[1]) {
+        error("File was not compressed by this program.");
     }
-    while (head->letter == 257){
-       string newPath = path + "0";
-       traverseTree(head->left, array, newPath);
-       newPath = path + "1";
-       traverseTree(head->right, array, newPath);
-       return;
+    if (bytes[2] != kFormatVersion) error("Unsupported compressed file version.");
+}
+
+/**
+ * Function: writeFileHeader
+ * -------------------------
+ * Writes the file header to a stream.
+ */
+static void writeFileHeader(obstream &outfile) {
+    char header[kFileHeaderSize];
+    storeFileHeader(header);
+    outfile.write(header, kFileHeaderSize);
+}
+
+/**
+ * Function: readFileHeader
+ * ------------------------
+ * Reads and checks the file header from a stream.
+ */
+static void readFileHeader(ibstream &infile) {
+    char header[kFileHeaderSize];
+    infile.read(header, kFileHeaderSize);
+    if (infile.gcount() != kFileHeaderSize) error("File was not compressed by this program.");
+    checkFileHeader(header);
+}
+
+/**
+ * Function: checkBlockHeader
+ * --------------------------
+ * Rejects block headers no compressor could have written, before anything is
+ * allocated for them.
+ */
+static void checkBlockHeader(uint32_t size, uint32_t bodySize) {
+    if (size > uint32_t(kMaxBlockSize) || bodySize == 0 || bodySize > uint32_t(kMaxBlockSize) * 2) {
+        error("Compressed block is corrupt.");
     }
 }
 
+/**
+ * Function: appendTrailer
+ * -----------------------
+ * Appends what follows the last block, which ends at offset end: the empty
+ * block that marks the end, then the block index, which lists the number of
+ * blocks followed by the file offset and character count of each, then the
+ * offset of the index itself and kIndexMagic, so the index can be found from
+ * the end of the file.
+ */
+static void appendTrailer(vector<char>& bytes, const vector<pair<uint64_t, uint32_t> >& index,
+                          uint64_t end) {
+    appendSize(bytes, 0);
+    appendSize(bytes, index.size());
+    for (size_t i = 0; i < index.size(); i++) {
+        appendOffset(bytes, index[i].first);
+        appendSize(bytes, index[i].second);
+    }
+    appendOffset(bytes, end + 4);
+    bytes.insert(bytes.end(), kIndexMagic, kIndexMagic + sizeof kIndexMagic);
+}
+
+/**
+ * Function: loadFooter
+ * --------------------
+ * Checks the footer that ends a compressed file of fileSize bytes and returns
+ * the offset of the block index, which must lie between the file header and
+ * the footer.
+ */
+static uint64_t loadFooter(const char *footer, uint64_t fileSize) {
+    if (memcmp(footer + 8, kIndexMagic, sizeof kIndexMagic) != 0) {
+        error("Compressed file has no block index.");
+    }
+    uint64_t indexOffset = loadOffset(footer);
+    if (indexOffset < uint64_t(kFileHeaderSize) + 4 || indexOffset > fileSize - kFooterSize - 4) {
+        error("Compressed file index is corrupt.");
+    }
+    return indexOffset;
+}
+
+/**
+ * Function: loadIndex
+ * -------------------
+ * Reads the size bytes of a block index, from its block count to the footer,
+ * into (block offset, character count) pairs.
+ */
+static void loadIndex(const char *bytes, size_t size, vector<pair<uint64_t, uint32_t> >& index) {
+    uint32_t count = loadSize(bytes);
+    if ((size - 4) / kIndexEntrySize != count || (size - 4) % kIndexEntrySize != 0) {
+        error("Compressed file index is corrupt.");
+    }
+    index.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const char *entry = bytes + 4 + size_t(i) * kIndexEntrySize;
+        index[i] = make_pair(loadOffset(entry), loadSize(entry + 8));
+    }
+}
+
+/**
+ * Function: selectBlocks
+ * ----------------------
+ * Finds the blocks holding the length characters from offset: first and end
+ * bound them, and start is where block first begins in the decompressed file.
+ */
+static void selectBlocks(const vector<pair<uint64_t, uint32_t> >& index, uint64_t offset, size_t length,
+                         size_t& first, size_t& end, uint64_t& start) {
+    uint64_t position = 0;
+    first = end = index.size();
+    start = 0;
+    for (size_t i = 0; i < index.size() && end == index.size(); i++) {
+        uint64_t next = position + index[i].second;
+        if (first == index.size() && offset < next) {
+            first = i;
+            start = position;
+        }
+        if (first != index.size() && offset + length <= next) end = i + 1;
+        position = next;
+    }
+    if (length == 0) {
+        first = end = 0;
+    } else if (end == index.size() && offset + length > position) {
+        error("Range is past the end of the decompressed file.");
+    }
+}
+
+/**
+ * Function: forEachBlock
+ * ----------------------
+ * Calls work(i) for each i below count on a pool of the given size, and waits
+ * for all of them.  An error raised by any call is raised again here.
+ */
+static void forEachBlock(int poolSize, size_t count, const function<void(size_t)>& work) {
+    vector<future<void> > done;            /* declared before the pool, which must go first */
+    ThreadPool pool(poolSize);
+    for (size_t i = 0; i < count; i++) {
+        done.push_back(pool.submit([&work, i]() { work(i); }));
+    }
+    for (size_t i = 0; i < done.size(); i++) {
+        done[i].get();
+    }
+}
+
+/**
+ * Function: countUsed
+ * -------------------
+ * Returns the number of characters, not counting the pseudo-EOF, that have codes.
+ */
+static int countUsed(const int lengths[]) {
+    int used = 0;
+    for (int letter = 0; letter < kPseudoEOF; letter++) {
+        if (lengths[letter] > 0) used++;
+    }
+    return used;
+}
+
+/**
+ * Function: chooseLayout
+ * ----------------------
+ * Picks whichever code length table layout is smaller for the number of
+ * characters used.
+ */
+static int chooseLayout(int used) {
+    return (2 * used + 1 < kNumSymbols) ? kSparseLayout : kDenseLayout;
+}
+
+/**
+ * Function: codeLengthsSize
+ * -------------------------
+ * Returns the number of bytes writeCodeLengths will write for lengths.
+ */
+static size_t codeLengthsSize(const int lengths[]) {
+    int used = countUsed(lengths);
+    return chooseLayout(used) == kSparseLayout ? 3 + 2 * used : 2 + kPseudoEOF;
+}
+
+/**
+ * Function: writeCodeLengths
+ * --------------------------
+ * Writes the code lengths for a block.  Only lengths are stored since canonical
+ * codes are determined by them.  When few characters are used, the table lists
+ * (character, length) pairs; otherwise it stores all 256 character lengths, zero
+ * for unused characters.  Either way the pseudo-EOF length comes right after the
+ * layout byte, which also carries kInterleavedFlag if the payload is split.
+ */
+static void writeCodeLengths(BitWriter &bits, const int lengths[], bool interleaved) {
+    int used = countUsed(lengths);
+    int layout = chooseLayout(used);
+    writeByte(bits, layout | (interleaved ? kInterleavedFlag : 0));
+    writeByte(bits, lengths[kPseudoEOF]);
+    if (layout == kSparseLayout) {
+        writeByte(bits, used);
+        for (int letter = 0; letter < kPseudoEOF; letter++) {
+            if (lengths[letter] == 0) continue;
+            writeByte(bits, letter);
+            writeByte(bits, lengths[letter]);
+        }
+    } else {
+        for (int letter = 0; letter < kPseudoEOF; letter++) {
+            writeByte(bits, lengths[letter]);
+        }
+    }
+}
+
+/**
+ * Function: readCodeLengths
+ * -------------------------
+ * Reads the table written by writeCodeLengths into lengths, and returns whether
+ * the payload that follows is split into streams.
+ */
+static bool readCodeLengths(BitReader &bits, int lengths[]) {
+    int layout = readByte(bits);
+    bool interleaved = (layout & kInterleavedFlag) != 0;
+    layout &= ~kInterleavedFlag;
+    for (int letter = 0; letter < kNumSymbols; letter++) {
+        lengths[letter] = 0;
+    }
+    lengths[kPseudoEOF] = readByte(bits);
+    if (layout == kSparseLayout) {
+        int used = readByte(bits);
+        for (int i = 0; i < used; i++) {
+            int letter = readByte(bits);
+            lengths[letter] = readByte(bits);
+        }
+    } else if (layout == kDenseLayout) {
+        for (int letter = 0; letter < kPseudoEOF; letter++) {
+            lengths[letter] = readByte(bits);
+        }
+    } else {
+        error("Compressed file header is corrupt.");
+    }
+    return interleaved;
+}
+
+/**
+ * Function: segmentStart
+ * ----------------------
+ * Returns where stream k's share of a block of size characters starts.  The
+ * shares are as even as possible, and stream kNumStreams ends at size.
+ */
+static int segmentStart(int size, int k, int numStreams) {
+    return int(int64_t(size) * k / numStreams);
+}
+
+/**
+ * Function: poolSize
+ * ------------------
+ * Returns the number of worker threads to start: none when only one thread is
+ * allowed, so that everything runs on the calling thread.
+ */
+int Encoding::poolSize() const {
+    return numThreads > 1 ? numThreads : 0;
+}
+
+/**
+ * Function: maxCompressedSize
+ * ---------------------------
+ * The payload of a block of b characters is never more than b + b / 1024 + 3
+ * bytes.  The code is optimal, so it does no worse than one in which the
+ * characters and the pseudo-EOF all get 8 bits, except that when all 256
+ * characters appear the two rarest ones and the pseudo-EOF get 9.  On top of
+ * that each block has its header, a code length table of at most 258 bytes,
+ * and an index entry, and the file has a header and a trailer.  An
+ * interleaved block splits its payload into kNumStreams streams, each ending
+ * in its own pseudo-EOF of at most 9 bits and padded to a whole byte, so it
+ * may take 2 more bytes per stream, plus the jump table to all but the first.
+ * Matched and context-modeled blocks are only used when they are smaller.
+ */
+size_t Encoding::maxCompressedSize(size_t size) const {
+    size_t blocks = (size + blockSize - 1) / blockSize;
+    size_t perBlock = kBlockHeaderSize + (2 + kPseudoEOF) + 12 + 4;
+    if (interleaved) perBlock += 4 * (kNumStreams - 1) + 2 * kNumStreams;
+    return kFileHeaderSize + 4 + 4 + 12 + blocks * perBlock + size + size / 1024;
+}
+
 /**
  * Function: compress
  * ------------------
  * compress compresses infile using Huffman Encoding and stores the result
- * in outfile.
- */
-void Encoding::compress(ibstream &infile, obstream &outfile) {
-    Map<int, int> counts; /* the number of times each character appears in the  */
-    int num;              /* file to be compressed will initially be stored in a */
-    while ((num = infile.get()) != EOF){ /* map. */
-        if (!counts.containsKey(num)){ /* if the character hasn't been seen, a new key */
-            counts.put(num, 1);        /* is added to the map. */
-        }else{                         /* otherwise the value is just incremented */
-            counts[num]++;
-        }
-    }
-    counts.put(256, 1);                 /* this adds a pseudo-EOF character to the map */
-
-    PQueue<entry> trees;                /* trees is a priority queue of all the subtrees that
-                                           will eventually make up our final tree.  entry is a
-                                           struct that contains both an element value and a
-                                           priority. This is so priorities can be combined as
-                                           trees are combined. */
-    outfile << counts.size()-1 << " "; /* adds to the header of the output file the number of
-                                          unique characters in the file, with the exception of
-                                          the pseudo-EOF character, as we know it occurs exactly
-                                          once. */
-    foreach(int key in counts){ /* adds each character and the number of times it occurs to the
-                                   header of the file, and enqueues a single node tree with that
-                                   character and the number of times it occurs as it's priority. */
-        if (key != 256) outfile << (char)key << counts[key] << " ";
-        head = new LinkedNode(key, NULL, NULL);
-        trees.enqueue({head, (double) counts[key]}, (double) counts[key]);
-    }
-    while (trees.size() > 1){ /* combines trees in the priority queue using the huffman algorithm
-                                 until onlya  single, final tree remains. */
-        entry first = trees.extractMin();
-        entry second = trees.extractMin();
-        double newPriority = first.priority+second.priority; /* the new priority is the sum of the combining trees priorities.*/
-        head = new LinkedNode(257, first.elem, second.elem);
-        trees.enqueue({head, newPriority}, first.priority+second.priority);
-    }
-    head = trees.extractMin().elem; /* head points to the head of the tree. */
+ * in outfile.  The input is read once, a block at a time, and each block is
+ * compressed on its own with its own code, so infile does not need to be
+ * seekable.  A mapped infile is not read at all: blocks are compressed where
+ * they lie in the mapping.  Blocks are handed to a pool of workers as they are
+ * read and written out in order as they finish; at most kBlocksPerThread blocks
+ * per thread are in flight.  A block with no characters marks the end of the
+ * blocks, and the block index follows it.
+ */
+uint64_t Encoding::compress(ibstream &infile, obstream &outfile) {
+    writeFileHeader(outfile);
+    vector<pair<uint64_t, uint32_t> > index;
+    uint64_t offset = kFileHeaderSize;
+    uint64_t characters = 0;
+    deque<unique_ptr<BlockJob> > pending;   /* declared before the pool, which must go first */
+    ThreadPool pool(poolSize());
+    size_t window = size_t(numThreads) * kBlocksPerThread;
+    bool more = true;
+    size_t mapPos = infile.isMapped() ? size_t(max(streamoff(infile.tellg()), streamoff(0))) : 0;
+    while (more || !pending.empty()) {
+        if (more && pending.size() < window) {
+            unique_ptr<BlockJob> job(new BlockJob);
+            if (infile.isMapped()) {
+                job->data = infile.mappedData() + mapPos;
+                job->size = min(infile.mappedSize() - mapPos, size_t(blockSize));
+                mapPos += job->size;
+            } else {
+                job->input.resize(blockSize);
+                infile.read(&job->input[0], blockSize);
+                job->data = &job->input[0];
+                job->size = infile.gcount();
+            }
+            more = (job->size == blockSize);
+            if (job->size == 0) continue;
+            BlockJob *block = job.get();
+            job->done = pool.submit([this, block]() {
+                compressBlock(block->data, block->size, block->output);
+            });
+            pending.push_back(move(job));
+            continue;
+        }
+        BlockJob& job = *pending.front();
+        job.done.get();
+        index.push_back(make_pair(offset, uint32_t(job.size)));
+        characters += job.size;
+        outfile.write(&job.output[0], job.output.size());
+        offset += job.output.size();
+        pending.pop_front();
+    }
+    if (infile.isMapped()) infile.seekg(0, ios::end); /* leaves the stream where reading would have */
+    vector<char> trailer;
+    appendTrailer(trailer, index, offset);
+    outfile.write(&trailer[0], trailer.size());
+    return characters;
+}
+
+/**
+ * Function: compress
+ * ------------------
+ * Compresses a span of memory into a vector.  Every block is planned first, in
+ * parallel, which gives the exact size of the output; then each block is written
+ * straight into its place in the output, also in parallel.
+ */
+void Encoding::compress(const char *data, size_t size, vector<char>& compressed) {
+    vector<BlockPlan> plans;
+    vector<pair<uint64_t, uint32_t> > index;
+    vector<char> trailer;
+    size_t length = planBlocks(data, size, plans, index, trailer);
+    compressed.resize(length);
+    writeBlocks(data, plans, index, trailer, &compressed[0]);
+}
+
+/**
+ * Function: compress
+ * ------------------
+ * Compresses a span of memory into memory the caller provides, the same way as
+ * the vector version.  Nothing is written if the result does not fit.
+ */
+size_t Encoding::compress(const char *data, size_t size, char *out, size_t capacity) {
+    vector<BlockPlan> plans;
+    vector<pair<uint64_t, uint32_t> > index;
+    vector<char> trailer;
+    size_t length = planBlocks(data, size, plans, index, trailer);
+    if (length > capacity) error("Output buffer is too small for the compressed data.");
+    writeBlocks(data, plans, index, trailer, out);
+    return length;
+}
+
+/**
+ * Function: planBlocks
+ * --------------------
+ * Splits size bytes of data into blocks and plans each of them, then lays the
+ * blocks out one after another to fill in the index and the trailer.  Returns
+ * the size of the whole compressed file.
+ */
+size_t Encoding::planBlocks(const char *data, size_t size, vector<BlockPlan>& plans,
+                            vector<pair<uint64_t, uint32_t> >& index, vector<char>& trailer) {
+    size_t numBlocks = (size + blockSize - 1) / blockSize;
+    plans.resize(numBlocks);
+    forEachBlock(poolSize(), numBlocks, [&](size_t block) {
+        size_t start = block * blockSize;
+        planBlock(data + start, min(size - start, size_t(blockSize)), plans[block]);
+    });
+    uint64_t offset = kFileHeaderSize;
+    for (size_t block = 0; block < numBlocks; block++) {
+        size_t start = block * blockSize;
+        index.push_back(make_pair(offset, uint32_t(min(size - start, size_t(blockSize)))));
+        offset += plans[block].bytes;
+    }
+    appendTrailer(trailer, index, offset);
+    return offset + trailer.size();
+}
+
+/**
+ * Function: writeBlocks
+ * ---------------------
+ * Writes the file header, every planned block, and the trailer to out, which
+ * must have room for all of them.
+ */
+void Encoding::writeBlocks(const char *data, const vector<BlockPlan>& plans,
+                           const vector<pair<uint64_t, uint32_t> >& index,
+                           const vector<char>& trailer, char *out) {
+    storeFileHeader(out);
+    forEachBlock(poolSize(), plans.size(), [&](size_t block) {
+        writeBlock(data + block * blockSize, index[block].second, plans[block], out + index[block].first);
+    });
+    uint64_t end = plans.empty() ? kFileHeaderSize : index.back().first + plans.back().bytes;
+    memcpy(out + end, &trailer[0], trailer.size());
+}
+
+/**
+ * Function: planBlock
+ * -------------------
+ * Counts the characters in the block and builds a code for them no longer than
+ * maxCodeLength bits.  The code also gives the exact size of the block once it
+ * is written.
+ */
+void Encoding::planBlock(const char *data, int size, BlockPlan& plan) {
+    uint32_t counts[kNumSymbols] = {}; /* the number of times each character appears in the block. */
+    uint32_t streamCounts[kNumStreams][kNumByteValues] = {};
+    plan.interleaved = interleaved;
+    if (interleaved) {
+        for (int k = 0; k < kNumStreams; k++) {
+            int start = segmentStart(size, k, kNumStreams);
+            countBytes(data + start, segmentStart(size, k + 1, kNumStreams) - start, streamCounts[k]);
+            for (int letter = 0; letter < kPseudoEOF; letter++) {
+                counts[letter] += streamCounts[k][letter];
+            }
+        }
+        counts[kPseudoEOF] = kNumStreams; /* each stream ends with a pseudo-EOF */
+    } else {
+        countBytes(data, size, counts);
+        counts[kPseudoEOF] = 1;         /* this adds a pseudo-EOF character to the counts */
+    }
+    buildLimitedCodeLengths(counts, plan.lengths, kNumSymbols, maxCodeLength);
+    assignCanonicalCodes(plan.lengths, plan.codes);
+
+    plan.bytes = kBlockHeaderSize + codeLengthsSize(plan.lengths);
+    if (interleaved) {
+        plan.bytes += 4 * (kNumStreams - 1);  /* the jump table */
+        for (int k = 0; k < kNumStreams; k++) {
+            uint64_t streamBits = plan.lengths[kPseudoEOF];
+            for (int letter = 0; letter < kPseudoEOF; letter++) {
+                streamBits += uint64_t(streamCounts[k][letter]) * plan.lengths[letter];
+            }
+            plan.streamBytes[k] = (streamBits + 7) / 8;
+            plan.bytes += plan.streamBytes[k];
+        }
+    } else {
+        uint64_t payloadBits = 0;
+        for (int letter = 0; letter < kNumSymbols; letter++) {
+            payloadBits += uint64_t(counts[letter]) * plan.lengths[letter];
+        }
+        plan.bytes += (payloadBits + 7) / 8;
+    }
+    plan.matched = false;
+    plan.tokens.clear();
+    plan.contextual = false;
+    if (contextModeling) planContextBlock(data, size, plan);
+    if (level > kMinLevel) planMatchBlock(data, size, plan);
+}
+
+/**
+ * Function: planContextBlock
+ * --------------------------
+ * Counts each character in the context of the one before it, groups the
+ * contexts, and builds a code for each group.  If the result would be smaller
+ * than the block already in plan, plan is switched over to it.  A single group
+ * is never kept, since it is the ordinary code with a bigger table.
+ */
+void Encoding::planContextBlock(const char *data, int size, BlockPlan& plan) {
+    vector<uint32_t> counts(kNumContexts * kNumSymbols, 0);
+    countContexts(data, size, &counts[0]);
+    uint8_t groups[kNumContexts];
+    int numGroups = groupContexts(&counts[0], kMaxContextGroups, groups);
+    if (numGroups < 2) return;
+
+    vector<uint32_t> groupCounts(numGroups * kNumSymbols, 0);
+    for (int context = 0; context < kNumContexts; context++) {
+        uint32_t *sums = &groupCounts[groups[context] * kNumSymbols];
+        const uint32_t *row = &counts[context * kNumSymbols];
+        for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+            sums[symbol] += row[symbol];
+        }
+    }
+    int limit = min(maxCodeLength, kMaxContextCodeLength);
+    vector<int> lengths(numGroups * kNumSymbols);
+    uint64_t bits = 8 * 2 + kNumContexts * kContextGroupBits;   /* layout byte, group count, map */
+    for (int group = 0; group < numGroups; group++) {
+        int *groupLengths = &lengths[group * kNumSymbols];
+        const uint32_t *sums = &groupCounts[group * kNumSymbols];
+        buildLimitedCodeLengths(sums, groupLengths, kNumSymbols, limit);
+        bits += kNumSymbols;
+        for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+            if (groupLengths[symbol] != 0) bits += kContextLengthBits;
+            bits += uint64_t(sums[symbol]) * groupLengths[symbol];
+        }
+    }
+    size_t bytes = kBlockHeaderSize + (bits + 7) / 8;
+    if (bytes >= plan.bytes) return;
+
+    plan.contextual = true;
+    plan.bytes = bytes;
+    plan.numGroups = numGroups;
+    copy(groups, groups + kNumContexts, plan.groups);
+    plan.groupLengths.swap(lengths);
+    plan.groupCodes.resize(numGroups * kNumSymbols);
+    for (int group = 0; group < numGroups; group++) {
+        assignCanonicalCodes(&plan.groupLengths[group * kNumSymbols], &plan.groupCodes[group * kNumSymbols]);
+    }
+}
+
+/**
+ * Function: planMatchBlock
+ * ------------------------
+ * Parses the block into LZ77 tokens and codes them with two codes: one for the
+ * literal/length symbols, including the pseudo-EOF, and one for the distance
+ * symbols.  The extra bits that pick a length or distance within a symbol's
+ * range are written as they are.  If the result would be smaller than the
+ * character-coded block already in plan, plan is switched over to it.
+ */
+void Encoding::planMatchBlock(const char *data, int size, BlockPlan& plan) {
+    vector<Token> tokens;
+    MatchFinder(level).findTokens(data, size, tokens);
+    uint32_t literalCounts[kNumLiteralLengthSymbols] = {};
+    uint32_t distanceCounts[kNumDistanceCodes] = {};
+    uint64_t payloadBits = 0;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        const Token& token = tokens[i];
+        if (token.length == 0) {
+            literalCounts[token.value]++;
+            continue;
+        }
+        int lengthIndex = lengthCode(token.length);
+        int distanceIndex = distanceCode(token.value);
+        literalCounts[kFirstLengthSymbol + lengthIndex]++;
+        distanceCounts[distanceIndex]++;
+        payloadBits += kLengthRanges[lengthIndex].extraBits + kDistanceRanges[distanceIndex].extraBits;
+    }
+    literalCounts[kPseudoEOF] = 1;
+
+    int limit = min(maxCodeLength, kMaxMatchCodeLength);
+    int literalLengths[kNumLiteralLengthSymbols];
+    int distanceLengths[kNumDistanceCodes];
+    buildLimitedCodeLengths(literalCounts, literalLengths, kNumLiteralLengthSymbols, limit);
+    buildLimitedCodeLengths(distanceCounts, distanceLengths, kNumDistanceCodes, limit);
+    for (int symbol = 0; symbol < kNumLiteralLengthSymbols; symbol++) {
+        payloadBits += uint64_t(literalCounts[symbol]) * literalLengths[symbol];
+    }
+    for (int symbol = 0; symbol < kNumDistanceCodes; symbol++) {
+        payloadBits += uint64_t(distanceCounts[symbol]) * distanceLengths[symbol];
+    }
+    size_t bytes = kBlockHeaderSize + kMatchTablesSize + (payloadBits + 7) / 8;
+    if (bytes >= plan.bytes) return;
+
+    plan.matched = true;
+    plan.contextual = false;
+    plan.bytes = bytes;
+    plan.tokens.swap(tokens);
+    copy(literalLengths, literalLengths + kNumLiteralLengthSymbols, plan.lengths);
+    copy(distanceLengths, distanceLengths + kNumDistanceCodes, plan.distanceLengths);
+    assignCanonicalCodes(plan.lengths, plan.codes, kNumLiteralLengthSymbols);
+    assignCanonicalCodes(plan.distanceLengths, plan.distanceCodes, kNumDistanceCodes);
+}
+
+/**
+ * Function: writeMatchTables
+ * --------------------------
+ * Writes the layout byte of a matched block and then the length of every
+ * literal/length and distance symbol in kMatchLengthBits bits each.
+ */
+static void writeMatchTables(BitWriter &bits, const int literalLengths[], const int distanceLengths[]) {
+    writeByte(bits, kMatchLayout);
+    for (int symbol = 0; symbol < kNumLiteralLengthSymbols; symbol++) {
+        bits.writeBits(literalLengths[symbol], kMatchLengthBits);
+    }
+    for (int symbol = 0; symbol < kNumDistanceCodes; symbol++) {
+        bits.writeBits(distanceLengths[symbol], kMatchLengthBits);
+    }
+}
+
+/**
+ * Function: readMatchTables
+ * -------------------------
+ * Reads the tables written by writeMatchTables, layout byte included.
+ */
+static void readMatchTables(BitReader &bits, int literalLengths[], int distanceLengths[]) {
+    readByte(bits);
+    for (int symbol = 0; symbol < kNumLiteralLengthSymbols; symbol++) {
+        literalLengths[symbol] = bits.peekBits(kMatchLengthBits);
+        bits.consume(kMatchLengthBits);
+    }
+    for (int symbol = 0; symbol < kNumDistanceCodes; symbol++) {
+        distanceLengths[symbol] = bits.peekBits(kMatchLengthBits);
+        bits.consume(kMatchLengthBits);
+    }
+}
+
+/**
+ * Function: encodeTokens
+ * ----------------------
+ * Writes each literal as its code, and each match as its length symbol, the
+ * length's extra bits, its distance symbol, and the distance's extra bits.
+ * The pseudo-EOF ends the payload.
+ */
+static void encodeTokens(const vector<Token>& tokens, BitWriter &bits,
+                         const Codeword literalCodes[], const Codeword distanceCodes[]) {
+    for (size_t i = 0; i < tokens.size(); i++) {
+        const Token& token = tokens[i];
+        if (token.length == 0) {
+            bits.writeBits(literalCodes[token.value].bits, literalCodes[token.value].length);
+            continue;
+        }
+        int lengthIndex = lengthCode(token.length);
+        const Codeword& lengthSymbol = literalCodes[kFirstLengthSymbol + lengthIndex];
+        bits.writeBits(lengthSymbol.bits, lengthSymbol.length);
+        bits.writeBits(token.length - kLengthRanges[lengthIndex].base, kLengthRanges[lengthIndex].extraBits);
+        int distanceIndex = distanceCode(token.value);
+        bits.writeBits(distanceCodes[distanceIndex].bits, distanceCodes[distanceIndex].length);
+        bits.writeBits(token.value - kDistanceRanges[distanceIndex].base, kDistanceRanges[distanceIndex].extraBits);
+    }
+    bits.writeBits(literalCodes[kPseudoEOF].bits, literalCodes[kPseudoEOF].length);
+}
+
+/**
+ * Function: writeContextTables
+ * ----------------------------
+ * Writes the layout byte of a context-modeled block, the number of groups, the
+ * group of every context in kContextGroupBits bits, and then each group's code:
+ * a bit for every symbol saying whether it has a code, followed by the lengths
+ * of the ones that do in kContextLengthBits bits each.  The payload follows
+ * without padding.
+ */
+static void writeContextTables(BitWriter &bits, const uint8_t groups[], int numGroups, const int lengths[]) {
+    writeByte(bits, kContextLayout);
+    writeByte(bits, numGroups);
+    for (int context = 0; context < kNumContexts; context++) {
+        bits.writeBits(groups[context], kContextGroupBits);
+    }
+    for (int group = 0; group < numGroups; group++) {
+        const int *groupLengths = lengths + group * kNumSymbols;
+        for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+            bits.writeBits(groupLengths[symbol] != 0, 1);
+        }
+        for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+            if (groupLengths[symbol] != 0) bits.writeBits(groupLengths[symbol], kContextLengthBits);
+        }
+    }
+}
+
+/**
+ * Function: readContextTables
+ * ---------------------------
+ * Reads the tables written by writeContextTables, layout byte included, into
+ * groups and lengths, and returns the number of groups.
+ */
+static int readContextTables(BitReader &bits, uint8_t groups[], vector<int>& lengths) {
+    readByte(bits);
+    int numGroups = readByte(bits);
+    if (numGroups == 0 || numGroups > kMaxContextGroups) error("Compressed file header is corrupt.");
+    for (int context = 0; context < kNumContexts; context++) {
+        groups[context] = bits.peekBits(kContextGroupBits);
+        bits.consume(kContextGroupBits);
+        if (groups[context] >= numGroups) error("Compressed file header is corrupt.");
+    }
+    lengths.assign(numGroups * kNumSymbols, 0);
+    for (int group = 0; group < numGroups; group++) {
+        int *groupLengths = &lengths[group * kNumSymbols];
+        for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+            groupLengths[symbol] = bits.peekBits(1);
+            bits.consume(1);
+        }
+        for (int symbol = 0; symbol < kNumSymbols; symbol++) {
+            if (groupLengths[symbol] == 0) continue;
+            groupLengths[symbol] = bits.peekBits(kContextLengthBits);
+            bits.consume(kContextLengthBits);
+        }
+    }
+    return numGroups;
+}
+
+/**
+ * Function: encodeContexts
+ * ------------------------
+ * Writes each character with the code of its context's group, and then the
+ * pseudo-EOF in the context of the last character.
+ */
+static void encodeContexts(const char *data, int size, BitWriter &bits, const uint8_t groups[],
+                           const vector<Codeword>& codes) {
+    const Codeword *contextCodes[kNumContexts];
+    for (int context = 0; context < kNumContexts; context++) {
+        contextCodes[context] = &codes[groups[context] * kNumSymbols];
+    }
+    int previous = 0;
+    for (int i = 0; i < size; i++) {
+        int letter = (unsigned char) data[i];
+        const Codeword& code = contextCodes[previous][letter];
+        bits.writeBits(code.bits, code.length);
+        previous = letter;
+    }
+    const Codeword& eof = contextCodes[previous][kPseudoEOF];
+    bits.writeBits(eof.bits, eof.length);
+}
+
+/**
+ * Function: writeBlock
+ * --------------------
+ * Writes a planned block to the plan.bytes bytes at out.  The block is
+ * self-describing: the number of characters, the number of bytes in the rest of
+ * the block, the code lengths, and then the payload, which is the codeword for
+ * every character followed by the pseudo-EOF, padded out to a whole byte.  An
+ * interleaved payload is instead a jump table giving the sizes in bytes of all
+ * but the last of kNumStreams streams, followed by the streams, each of which is
+ * an ordinary payload for its share of the block.  A matched block has its two
+ * code length tables and then its tokens.
+ */
+void Encoding::writeBlock(const char *data, int size, const BlockPlan& plan, char *out) {
+    storeSize(out, size);
+    storeSize(out + 4, plan.bytes - kBlockHeaderSize);
+    BitWriter bits(out + kBlockHeaderSize, plan.bytes - kBlockHeaderSize);
+    if (plan.matched) {
+        writeMatchTables(bits, plan.lengths, plan.distanceLengths);
+        encodeTokens(plan.tokens, bits, plan.codes, plan.distanceCodes);
+        bits.flush();
+        return;
+    }
+    if (plan.contextual) {
+        writeContextTables(bits, plan.groups, plan.numGroups, &plan.groupLengths[0]);
+        encodeContexts(data, size, bits, plan.groups, plan.groupCodes);
+        bits.flush();
+        return;
+    }
+    writeCodeLengths(bits, plan.lengths, plan.interleaved);
+    if (!plan.interleaved) {
+        encodeSegment(data, size, bits, plan.codes);
+        bits.flush();                   /* pads the payload to a whole byte. */
+        return;
+    }
+    for (int k = 0; k < kNumStreams - 1; k++) {
+        bits.writeBits(plan.streamBytes[k], 32);
+    }
+    bits.flush();
+    char *stream = out + kBlockHeaderSize + codeLengthsSize(plan.lengths) + 4 * (kNumStreams - 1);
+    for (int k = 0; k < kNumStreams; k++) {
+        int start = segmentStart(size, k, kNumStreams);
+        BitWriter streamBits(stream, plan.streamBytes[k]);
+        encodeSegment(data + start, segmentStart(size, k + 1, kNumStreams) - start, streamBits, plan.codes);
+        streamBits.flush();
+        stream += plan.streamBytes[k];
+    }
+}
+
+/**
+ * Function: encodeSegment
+ * -----------------------
+ * Encodes characters and a closing pseudo-EOF with the encoder chosen by
+ * setEncoder.
+ */
+void Encoding::encodeSegment(const char *data, int size, BitWriter &bits, const Codeword codes[]) {
+    if (encoder == STRING_PATHS) {
+        encodeWithStrings(data, size, bits, codes);
+    } else {
+        encodeWithCodes(data, size, bits, codes);
+    }
+}
+
+/**
+ * Function: compressBlock
+ * -----------------------
+ * Plans a block and writes it to out, replacing what was there.  Blocks share
+ * nothing, so several can be compressed at once.
+ */
+void Encoding::compressBlock(const char *data, int size, vector<char>& out) {
+    BlockPlan plan;
+    planBlock(data, size, plan);
+    out.resize(plan.bytes);
+    writeBlock(data, size, plan, &out[0]);
+}
+
+/**
+ * Function: buildCodeLengths
+ * --------------------------
+ * Builds a Huffman tree for the characters with nonzero counts and stores the code
+ * length of each character, which is all that is kept of the tree.  The leaves are
+ * sorted by count once, and since every merged tree weighs at least as much as the
+ * one merged before it, the merged trees come out in order too: the two lightest
+ * trees are always at the fronts of the two queues.  Node i of the tree is the
+ * i'th leaf for i < used and the (i - used)'th merged tree after that, and only
+ * its weight and parent are kept, all on the stack.
+ */
+void Encoding::buildCodeLengths(const uint32_t counts[], int lengths[], int numSymbols) {
+    const int kMaxNodes = 2 * kNumLiteralLengthSymbols - 1;
+    uint16_t symbols[kNumLiteralLengthSymbols];
+    uint64_t weight[kMaxNodes];
+    uint16_t parent[kMaxNodes];
+    int used = 0;
+    for (int symbol = 0; symbol < numSymbols; symbol++) {
+        if (counts[symbol] != 0) symbols[used++] = symbol;
+    }
+    if (used == 0) return;              /* a block with no matches has no distances to code. */
+    if (used == 1) {
+        lengths[symbols[0]] = 1;        /* a lone character still needs a one-bit code. */
+        return;
+    }
+    sort(symbols, symbols + used, [counts](int a, int b) {
+        return counts[a] < counts[b] || (counts[a] == counts[b] && a < b);
+    });
+    for (int i = 0; i < used; i++) {
+        weight[i] = counts[symbols[i]];
+    }
+
+    /* Each merge takes the lighter front twice, a leaf on a tie, which keeps codes short. */
+    int nextLeaf = 0, nextMerged = used, numNodes = used;
+    while (numNodes < 2 * used - 1) {
+        int pair[2];
+        for (int k = 0; k < 2; k++) {
+            if (nextLeaf < used && (nextMerged == numNodes || weight[nextLeaf] <= weight[nextMerged])) {
+                pair[k] = nextLeaf++;
+            } else {
+                pair[k] = nextMerged++;
+            }
+        }
+        weight[numNodes] = weight[pair[0]] + weight[pair[1]];
+        parent[pair[0]] = parent[pair[1]] = numNodes;
+        numNodes++;
+    }
+
+    /* Parents come after their children, so one pass down from the root finds every depth. */
+    uint16_t depth[kMaxNodes];
+    depth[numNodes - 1] = 0;
+    for (int node = numNodes - 2; node >= 0; node--) {
+        depth[node] = depth[parent[node]] + 1;
+    }
+    for (int i = 0; i < used; i++) {
+        if (depth[i] > kMaxCodeLength) error("Huffman code is too long to encode.");
+        lengths[symbols[i]] = depth[i];
+    }
+}
+
+/**
+ * Function: buildLimitedCodeLengths
+ * ---------------------------------
+ * Fills lengths with a Huffman code for the numSymbols counts, zero for unused
+ * symbols, and falls back to package-merge if any code is longer than limit.
+ */
+void Encoding::buildLimitedCodeLengths(const uint32_t counts[], int lengths[], int numSymbols, int limit) {
+    fill(lengths, lengths + numSymbols, 0);
+    buildCodeLengths(counts, lengths, numSymbols);
+    if (*max_element(lengths, lengths + numSymbols) > limit) {
+        limitCodeLengths(counts, limit, lengths, numSymbols); /* rarely needed, so only done when it is. */
+    }
+}
+
+/**
+ * Function: encodeWithCodes
+ * -------------------------
+ * Writes the codeword for every character in the block, followed by the pseudo-EOF.
+ * Each codeword goes out whole through the bit writer, so nothing is allocated
+ * and there is one writeBits call per character.
+ */
+void Encoding::encodeWithCodes(const char *data, int size, BitWriter &bits, const Codeword codes[]) {
+    for (int i = 0; i < size; i++) {
+        const Codeword& code = codes[(unsigned char) data[i]];
+        bits.writeBits(code.bits, code.length);
+    }
+    bits.writeBits(codes[kPseudoEOF].bits, codes[kPseudoEOF].length);
+}
+
+/**
+ * Function: encodeWithStrings
+ * ---------------------------
+ * The original encoding loop, which spells each code out as a string of '0' and '1'
+ * characters and writes it one bit at a time.
+ */
+void Encoding::encodeWithStrings(const char *data, int size, BitWriter &bits, const Codeword codes[]) {
     string array[257]; /* the 257 index array that will be used  for quick lookup. */
-    fillArray(head, array);
-    infile.rewind();
-    while ((num = infile.get()) != EOF){                                /* writes the bits to outfile that represent */
-        for (int i = 0; i < array[num].length(); i++){                  /* each character in infile. */
-            outfile.writebit(stringToInteger(array[num].substr(i,1)));
+    fillArray(codes, array);
+    for (int j = 0; j < size; j++){                                     /* writes the bits to outfile that represent */
+        int num = (unsigned char) data[j];                              /* each character in the block. */
+        for (int i = 0; i < array[num].length(); i++){
+            bits.writeBits(array[num][i] == '1', 1);
         }
     }
-    for (int i = 0; i < array[256].length(); i++){                      /* writes the pseudo-EOF bits to the end of the file. */
-        outfile.writebit(stringToInteger(array[256].substr(i,1)));
+    for (int i = 0; i < array[256].length(); i++){                      /* writes the pseudo-EOF bits to the end of the block. */
+        bits.writeBits(array[256][i] == '1', 1);
     }
 }
 
@@ -135,56 +1173,651 @@ void Encoding::compress(ibstream &infile, obstream &outfile) {
 /**
  * Function: decompress
  * --------------------
- * decompresses a ompressed file to its previous, readable state. Characters are determined
- * by traversing through the encoding tree according to the bits in the compressed file until a character is
- * found.
+ * decompresses a ompressed file to its previous, readable state. Each block is read
+ * whole, using the sizes in its header, and handed to a pool of workers; finished
+ * blocks are written out in order.  If infile is mapped and has not been read from,
+ * the blocks are found in the mapping and decoded from there instead.  The block
+ * index after the last block is not needed to read the file from the front and is
+ * left unread.
  */
 void Encoding::decompress(ibstream &infile, obstream &outfile) {
-    char ch;
-    string numberUniqueChars = "";      /* determines the number of unique characters within the  */
-    while ((ch = infile.get()) != ' '){ /* decompressed file, so it knows how many to add to the  */
-        numberUniqueChars += ch;        /* encoding tree. */
-    }
-    int numUniqueChars = stringToInteger(numberUniqueChars);
-    Map<int, int> counts;
-    for (int i = 0; i < numUniqueChars; i++){   /* populates a map of characters and their frequency using the */
-        int letter = infile.get();              /* header of the file.  characters are followed by their frequency */
-        string numberOfChars = "";              /* in the header file. */
-        while ((ch = infile.get()) != ' '){
-            numberOfChars += ch;
-        }
-        int numOfChars = stringToInteger(numberOfChars);
-        counts.put(letter, numOfChars);
-    }
-    counts.put(256, 1);
-    PQueue<entry> trees;                        /* populates a queue with trees, and combines trees, as is done in  */
-    foreach(int key in counts){                 /* the compress method. */
-        head = new LinkedNode(key, NULL, NULL);
-        trees.enqueue({head, (double) counts[key]}, (double) counts[key]);
-    }
-    while (trees.size() > 1){
-        entry first = trees.extractMin();
-        entry second = trees.extractMin();
-        double newPriority = first.priority+second.priority;
-        head = new LinkedNode(257, first.elem, second.elem);
-        trees.enqueue({head, newPriority}, first.priority+second.priority);
-    }
-    head = trees.extractMin().elem;
-    LinkedNode * current = head;
-    int bit;
-    while (true){ /* adds the characters represented by bits in the compressed file to outfile. */
-        if (current->letter == 256) return; /* pseudo-EOF, stops looking through infile for more characters */
-        if (current->letter < 257){
-            outfile << (char) current->letter; /* adds the represented character to outfile, */
+    vector<BlockSpan> mappedBlocks;
+    bool mapped = infile.isMapped() && infile.tellg() == streampos(0);
+    if (mapped) {
+        findBlocks(infile.mappedData(), infile.mappedSize(), mappedBlocks);
+    } else {
+        readFileHeader(infile);
+    }
+    size_t nextBlock = 0;
+    deque<unique_ptr<BlockJob> > pending;   /* declared before the pool, which must go first */
+    ThreadPool pool(poolSize());
+    size_t window = size_t(numThreads) * kBlocksPerThread;
+    bool more = true;
+    while (more || !pending.empty()) {
+        if (more && pending.size() < window) {
+            unique_ptr<BlockJob> job(new BlockJob);
+            uint32_t size;
+            if (mapped) {
+                if (nextBlock == mappedBlocks.size()) {
+                    more = false;
+                    continue;
+                }
+                const BlockSpan& block = mappedBlocks[nextBlock++];
+                job->data = block.body;
+                job->size = block.bodySize;
+                size = block.size;
+            } else {
+                char header[kBlockHeaderSize];
+                readFully(infile, header, 4);
+                size = loadSize(header);
+                if (size == 0) {
+                    more = false;
+                    continue;
+                }
+                readFully(infile, header + 4, 4);
+                uint32_t bodySize = loadSize(header + 4);
+                checkBlockHeader(size, bodySize);
+                job->input.resize(bodySize);
+                readFully(infile, &job->input[0], bodySize);
+                job->data = &job->input[0];
+                job->size = bodySize;
+            }
+            job->output.resize(size);
+            BlockJob *block = job.get();
+            job->done = pool.submit([this, block]() {
+                decompressBlock(block->data, block->size, &block->output[0], block->output.size());
+            });
+            pending.push_back(move(job));
+            continue;
+        }
+        BlockJob& job = *pending.front();
+        job.done.get();
+        outfile.write(&job.output[0], job.output.size());
+        pending.pop_front();
+    }
+}
+
+/**
+ * Function: decompress
+ * --------------------
+ * Decompresses a span of memory into a vector, sized from the block headers.
+ * Every block is decoded straight into its place in the output, in parallel.
+ */
+void Encoding::decompress(const char *data, size_t size, vector<char>& decompressed) {
+    vector<BlockSpan> blocks;
+    findBlocks(data, size, blocks);
+    decompressed.resize(blocks.empty() ? 0 : blocks.back().offset + blocks.back().size);
+    decodeBlocks(blocks, decompressed.data());
+}
+
+/**
+ * Function: decompress
+ * --------------------
+ * Decompresses a span of memory into memory the caller provides, the same way as
+ * the vector version.  Nothing is written if the result does not fit.
+ */
+size_t Encoding::decompress(const char *data, size_t size, char *out, size_t capacity) {
+    vector<BlockSpan> blocks;
+    findBlocks(data, size, blocks);
+    size_t length = blocks.empty() ? 0 : blocks.back().offset + blocks.back().size;
+    if (length > capacity) error("Output buffer is too small for the decompressed data.");
+    decodeBlocks(blocks, out);
+    return length;
+}
+
+/**
+ * Function: decompressedSize
+ * --------------------------
+ * Adds up the character counts in the block headers.
+ */
+size_t Encoding::decompressedSize(const char *data, size_t size) const {
+    vector<BlockSpan> blocks;
+    findBlocks(data, size, blocks);
+    return blocks.empty() ? 0 : blocks.back().offset + blocks.back().size;
+}
+
+/**
+ * Function: decompressRange
+ * -------------------------
+ * Reads the footer, the block index, and then only the blocks the range falls
+ * in.  A mapped file is handled by the in-memory version.
+ */
+void Encoding::decompressRange(ibstream &infile, uint64_t offset, size_t length, vector<char>& out) {
+    if (infile.isMapped()) {
+        decompressRange(infile.mappedData(), infile.mappedSize(), offset, length, out);
+        return;
+    }
+    uint64_t size = infile.size();
+    if (size < uint64_t(kFileHeaderSize) + 4 + kFooterSize) error("File was not compressed by this program.");
+    char header[kFooterSize];
+    infile.seekg(0);
+    readFully(infile, header, kFileHeaderSize);
+    checkFileHeader(header);
+    infile.seekg(size - kFooterSize);
+    readFully(infile, header, kFooterSize);
+    uint64_t indexOffset = loadFooter(header, size);
+    vector<char> indexBytes(size - kFooterSize - indexOffset);
+    infile.seekg(indexOffset);
+    readFully(infile, &indexBytes[0], indexBytes.size());
+    vector<pair<uint64_t, uint32_t> > index;
+    loadIndex(&indexBytes[0], indexBytes.size(), index);
+
+    size_t first, end;
+    uint64_t start;
+    selectBlocks(index, offset, length, first, end, start);
+    vector<vector<char> > bodies(end - first);
+    vector<BlockSpan> blocks;
+    size_t blockOffset = 0;
+    for (size_t i = first; i < end; i++) {
+        if (index[i].first + kBlockHeaderSize > indexOffset) error("Compressed file index is corrupt.");
+        infile.seekg(index[i].first);
+        readFully(infile, header, kBlockHeaderSize);
+        uint32_t bodySize = loadSize(header + 4);
+        checkBlockHeader(loadSize(header), bodySize);
+        if (loadSize(header) != index[i].second) error("Compressed file index is corrupt.");
+        vector<char>& body = bodies[i - first];
+        body.resize(bodySize);
+        readFully(infile, &body[0], bodySize);
+        BlockSpan block = {&body[0], bodySize, index[i].second, blockOffset};
+        blocks.push_back(block);
+        blockOffset += index[i].second;
+    }
+    decodeRange(blocks, offset - start, length, out);
+}
+
+/**
+ * Function: decompressRange
+ * -------------------------
+ * Finds the blocks the range falls in through the index at the end of data and
+ * decodes them where they lie.
+ */
+void Encoding::decompressRange(const char *data, size_t size, uint64_t offset, size_t length,
+                               vector<char>& out) {
+    if (size < size_t(kFileHeaderSize) + 4 + kFooterSize) error("File was not compressed by this program.");
+    checkFileHeader(data);
+    uint64_t indexOffset = loadFooter(data + size - kFooterSize, size);
+    vector<pair<uint64_t, uint32_t> > index;
+    loadIndex(data + indexOffset, size - kFooterSize - indexOffset, index);
+
+    size_t first, end;
+    uint64_t start;
+    selectBlocks(index, offset, length, first, end, start);
+    vector<BlockSpan> blocks;
+    size_t blockOffset = 0;
+    for (size_t i = first; i < end; i++) {
+        uint64_t position = index[i].first;
+        if (position + kBlockHeaderSize > indexOffset) error("Compressed file index is corrupt.");
+        uint32_t bodySize = loadSize(data + position + 4);
+        checkBlockHeader(loadSize(data + position), bodySize);
+        if (loadSize(data + position) != index[i].second || position + kBlockHeaderSize + bodySize > indexOffset) {
+            error("Compressed file index is corrupt.");
+        }
+        BlockSpan block = {data + position + kBlockHeaderSize, bodySize, index[i].second, blockOffset};
+        blocks.push_back(block);
+        blockOffset += index[i].second;
+    }
+    decodeRange(blocks, offset - start, length, out);
+}
+
+/**
+ * Function: decodeRange
+ * ---------------------
+ * Decodes the blocks holding a range, in parallel, and keeps the length
+ * characters that start skip characters into the first of them.  When the range
+ * is exactly the blocks, they are decoded straight into out.
+ */
+void Encoding::decodeRange(const vector<BlockSpan>& blocks, uint64_t skip, size_t length, vector<char>& out) {
+    size_t total = blocks.empty() ? 0 : blocks.back().offset + blocks.back().size;
+    if (skip == 0 && length == total) {
+        out.resize(length);
+        decodeBlocks(blocks, out.data());
+        return;
+    }
+    vector<char> decoded(total);
+    decodeBlocks(blocks, decoded.data());
+    out.assign(decoded.begin() + skip, decoded.begin() + skip + length);
+}
+
+/**
+ * Function: findBlocks
+ * --------------------
+ * Walks the block headers of a compressed file held in memory, up to the empty
+ * block that ends them, and records where each block is and where its characters
+ * go.  Raises an error if the blocks run past the end of the data.
+ */
+void Encoding::findBlocks(const char *data, size_t size, vector<BlockSpan>& blocks) const {
+    if (size < size_t(kFileHeaderSize)) error("File was not compressed by this program.");
+    checkFileHeader(data);
+    size_t pos = kFileHeaderSize;
+    size_t offset = 0;
+    while (true) {
+        if (size - pos < 4) error("Compressed file is truncated.");
+        uint32_t blockChars = loadSize(data + pos);
+        if (blockChars == 0) break;
+        if (size - pos < size_t(kBlockHeaderSize)) error("Compressed file is truncated.");
+        uint32_t bodySize = loadSize(data + pos + 4);
+        checkBlockHeader(blockChars, bodySize);
+        pos += kBlockHeaderSize;
+        if (size - pos < bodySize) error("Compressed file is truncated.");
+        BlockSpan block = {data + pos, bodySize, blockChars, offset};
+        blocks.push_back(block);
+        pos += bodySize;
+        offset += blockChars;
+    }
+}
+
+/**
+ * Function: decodeBlocks
+ * ----------------------
+ * Decodes every block into its place in out, in parallel.
+ */
+void Encoding::decodeBlocks(const vector<BlockSpan>& blocks, char *out) {
+    forEachBlock(poolSize(), blocks.size(), [&](size_t i) {
+        const BlockSpan& block = blocks[i];
+        decompressBlock(block.body, block.bodySize, out + block.offset, block.size);
+    });
+}
+
+/**
+ * Function: decompressBlock
+ * -------------------------
+ * Decodes the body of one block into the size characters at out.  The canonical
+ * codes are rebuilt from the code lengths at the start of the body, and the bits
+ * that follow are decoded with the decoder chosen by setDecoder, one stream at a
+ * time for the tree walker and all streams together for the table decoder.
+ * Matched blocks always use decode tables.
+ */
+void Encoding::decompressBlock(const char *body, int bodySize, char *out, int size) {
+    BitReader bits(body, bodySize);
+    if (bits.peekBits(8) == kMatchLayout) {
+        int literalLengths[kNumLiteralLengthSymbols];
+        int distanceLengths[kNumDistanceCodes];
+        readMatchTables(bits, literalLengths, distanceLengths);
+        Codeword literalCodes[kNumLiteralLengthSymbols];
+        Codeword distanceCodes[kNumDistanceCodes];
+        assignCanonicalCodes(literalLengths, literalCodes, kNumLiteralLengthSymbols);
+        assignCanonicalCodes(distanceLengths, distanceCodes, kNumDistanceCodes);
+        if (decodeMatches(bits, literalCodes, distanceCodes, out, size) != size) {
+            error("Compressed block is corrupt.");
+        }
+        return;
+    }
+    if (bits.peekBits(8) == kContextLayout) {
+        uint8_t groups[kNumContexts];
+        vector<int> groupLengths;
+        int numGroups = readContextTables(bits, groups, groupLengths);
+        vector<Codeword> groupCodes(numGroups * kNumSymbols);
+        for (int group = 0; group < numGroups; group++) {
+            assignCanonicalCodes(&groupLengths[group * kNumSymbols], &groupCodes[group * kNumSymbols]);
+        }
+        if (decodeContexts(bits, groups, numGroups, &groupCodes[0], out, size) != size) {
+            error("Compressed block is corrupt.");
+        }
+        return;
+    }
+    int lengths[kNumSymbols];
+    bool split = readCodeLengths(bits, lengths);
+    Codeword codes[kNumSymbols];
+    assignCanonicalCodes(lengths, codes);
+    if (!split) {
+        long decoded;
+        if (decoder == TREE_WALK) {
+            TreeArena tree;
+            decoded = decodeWithTree(bits, tree, buildTree(codes, tree), out, size);
+        } else {
+            decoded = decodeWithTable(bits, codes, out, size);
+        }
+        if (decoded != size) error("Compressed block is corrupt.");
+        return;
+    }
+
+    size_t streamBytes[kNumStreams];
+    size_t total = 0;
+    for (int k = 0; k < kNumStreams - 1; k++) {
+        streamBytes[k] = bits.peekBits(32);
+        bits.consume(32);
+        total += streamBytes[k];
+    }
+    size_t left = bits.unreadBytes();
+    if (total > left) error("Compressed block is corrupt.");
+    streamBytes[kNumStreams - 1] = left - total;
+    const char *stream = body + (bodySize - left);
+    BitReader streams[kNumStreams];
+    for (int k = 0; k < kNumStreams; k++) {
+        streams[k].setSource(stream, streamBytes[k]);
+        stream += streamBytes[k];
+    }
+    if (decoder == TREE_WALK) {
+        TreeArena tree;
+        int head = buildTree(codes, tree);
+        for (int k = 0; k < kNumStreams; k++) {
+            int start = segmentStart(size, k, kNumStreams);
+            int length = segmentStart(size, k + 1, kNumStreams) - start;
+            if (decodeWithTree(streams[k], tree, head, out + start, length) != length) {
+                error("Compressed block is corrupt.");
+            }
+        }
+    } else {
+        decodeInterleaved(streams, codes, out, size);
+    }
+}
+
+/**
+ * Function: buildTree
+ * -------------------
+ * Rebuilds an encoding tree from a codebook by following each codeword from the
+ * head, creating nodes as needed, and placing the character at the end of the path.
+ * Returns the index of the head of the tree.
+ */
+int Encoding::buildTree(const Codeword codes[], TreeArena& tree) {
+    int head = tree.add(TreeArena::kNoLetter, TreeArena::kNoNode, TreeArena::kNoNode);
+    for (int letter = 0; letter < kNumSymbols; letter++) {
+        int current = head;
+        for (int i = 0; i < codes[letter].length; i++) {
+            int bit = (codes[letter].bits >> i) & 1;
+            if (tree.child[current][bit] == TreeArena::kNoNode) {
+                int child = tree.add(TreeArena::kNoLetter, TreeArena::kNoNode, TreeArena::kNoNode);
+                tree.child[current][bit] = child;
+            }
+            current = tree.child[current][bit];
+        }
+        if (codes[letter].length > 0) tree.letter[current] = letter;
+    }
+    return head;
+}
+
+/**
+ * Function: decodeWithTree
+ * ------------------------
+ * The original decoding loop: characters are determined by traversing through the
+ * encoding tree according to the bits in the compressed block until a character is
+ * found.  Returns the number of characters decoded before the pseudo-EOF, or raises
+ * an error if there are more than capacity or the bits leave the tree.
+ */
+long Encoding::decodeWithTree(BitReader &bits, const TreeArena& tree, int head, char *out, long capacity) {
+    int current = head;
+    long decoded = 0;
+    while (true){ /* adds the characters represented by bits in the compressed block to out. */
+        int letter = tree.letter[current];
+        if (letter == 256) return decoded; /* pseudo-EOF, stops looking through the block for more characters */
+        if (letter < 257){
+            if (decoded == capacity) error("Compressed block is corrupt.");
+            out[decoded++] = (char) letter;    /* adds the represented character to out, */
             current = head;                    /* and points current back to the head. */
         }
-        bit = infile.readbit();                 /* reads the next bit */
-        if (bit == 0){ /* this is left as bit == 0 instead of !bit as it implies why current points to the left child. */
-            current = current->left;             /* if it's a 0, point current to the left child. */
+        int bit = bits.peekBits(1);            /* reads the next bit */
+        bits.consume(1);
+        current = tree.child[current][bit];    /* a 0 leads to the left child, a 1 to the right. */
+        if (current == TreeArena::kNoNode) error("Compressed block is corrupt.");
+    }
+}
+
+/**
+ * Function: nextEntry
+ * -------------------
+ * Looks up the table entry for the next codeword or two in bits, following links
+ * into secondary tables, and consumes their bits.
+ */
+static inline DecodeTable::Entry nextEntry(BitReader &bits, const DecodeTable::Entry *entries) {
+    DecodeTable::Entry entry = entries[bits.peekBits(DecodeTable::kTableBits)];
+    while (entry.count == 0) {                  /* follow links into secondary tables. */
+        if (entry.subBits == 0) error("Compressed file is corrupt.");
+        bits.consume(entry.bits);
+        entry = entries[entry.value + bits.peekBits(entry.subBits)];
+    }
+    bits.consume(entry.bits);
+    return entry;
+}
+
+/**
+ * Function: decodeSymbols
+ * -----------------------
+ * Decodes bits with the table until the pseudo-EOF.  Returns the number of
+ * characters decoded, or raises an error if there are more than capacity.
+ */
+static long decodeSymbols(BitReader &bits, const DecodeTable::Entry *entries, char *out, long capacity) {
+    long decoded = 0;
+    while (true) {
+        DecodeTable::Entry entry = nextEntry(bits, entries);
+        int letter = entry.value & 0xFFFF;
+        if (letter == kPseudoEOF) break;
+        if (decoded == capacity) error("Compressed block is corrupt.");
+        out[decoded++] = (char) letter;
+        if (entry.count == 2) {
+            letter = entry.value >> 16;
+            if (letter == kPseudoEOF) break;
+            if (decoded == capacity) error("Compressed block is corrupt.");
+            out[decoded++] = (char) letter;
+        }
+    }
+    return decoded;
+}
+
+/**
+ * Function: decodeContexts
+ * ------------------------
+ * Decodes a context-modeled payload with a DecodeTable for each group, looking
+ * each character up in the table for the character before it.  The tables do
+ * not pair symbols, since the second of a pair would need a different table.
+ * Returns the number of characters decoded before the pseudo-EOF.
+ */
+long Encoding::decodeContexts(BitReader &bits, const uint8_t groups[], int numGroups,
+                              const Codeword codes[], char *out, long capacity) {
+    vector<DecodeTable> tables(numGroups);
+    for (int group = 0; group < numGroups; group++) {
+        tables[group].build(codes + group * kNumSymbols, kNumSymbols, false);
+    }
+    const DecodeTable::Entry *contextEntries[kNumContexts];
+    for (int context = 0; context < kNumContexts; context++) {
+        contextEntries[context] = tables[groups[context]].entries();
+    }
+    long decoded = 0;
+    int previous = 0;
+    while (true) {
+        int letter = nextEntry(bits, contextEntries[previous]).value;
+        if (letter == kPseudoEOF) break;
+        if (decoded == capacity) error("Compressed block is corrupt.");
+        out[decoded++] = (char) letter;
+        previous = letter;
+    }
+    return decoded;
+}
+
+/**
+ * Function: decodeWithTable
+ * -------------------------
+ * Decodes using a DecodeTable built from the codebook.  Each probe of the table
+ * looks at the next bits of the block and consumes one or two whole codewords.
+ * Running out of bits before the pseudo-EOF is found raises an error from consume,
+ * as does decoding more than capacity characters.  Returns the number of characters
+ * decoded before the pseudo-EOF.
+ */
+long Encoding::decodeWithTable(BitReader &bits, const Codeword codes[], char *out, long capacity) {
+    DecodeTable table;
+    table.build(codes);
+    return decodeSymbols(bits, table.entries(), out, capacity);
+}
+
+/**
+ * Function: profileStages
+ * -----------------------
+ * Runs the stages of planBlock, writeBlock, and decompressBlock one after the
+ * other for each block, reading the clock between them.  The payload goes to
+ * a scratch buffer sized from the code, as planBlock sizes it.
+ */
+void Encoding::profileStages(const char *data, size_t size, StageTimes& times) {
+    typedef chrono::steady_clock Clock;
+    vector<char> payload;
+    vector<char> decoded(min(size, size_t(blockSize)));
+    for (size_t start = 0; start < size; start += blockSize) {
+        int length = min(size - start, size_t(blockSize));
+        const char *block = data + start;
+
+        Clock::time_point before = Clock::now();
+        uint32_t counts[kNumSymbols] = {};
+        countBytes(block, length, counts);
+        counts[kPseudoEOF] = 1;
+        Clock::time_point counted = Clock::now();
+
+        int lengths[kNumSymbols];
+        buildLimitedCodeLengths(counts, lengths, kNumSymbols, maxCodeLength);
+        Clock::time_point built = Clock::now();
+
+        Codeword codes[kNumSymbols];
+        assignCanonicalCodes(lengths, codes);
+        DecodeTable table;
+        TreeArena tree;
+        int head = 0;
+        if (decoder == TREE_WALK) {
+            head = buildTree(codes, tree);
+        } else {
+            table.build(codes);
+        }
+        Clock::time_point coded = Clock::now();
+
+        uint64_t payloadBits = 0;
+        for (int letter = 0; letter < kNumSymbols; letter++) {
+            payloadBits += uint64_t(counts[letter]) * lengths[letter];
         }
-        if (bit == 1){                          /* if it's a 1, point current to the right child. */
-            current = current->right;
+        payload.resize((payloadBits + 7) / 8);
+        BitWriter writer(&payload[0], payload.size());
+        encodeSegment(block, length, writer, codes);
+        writer.flush();
+        Clock::time_point encoded = Clock::now();
+
+        BitReader reader(&payload[0], payload.size());
+        long count = decoder == TREE_WALK ? decodeWithTree(reader, tree, head, &decoded[0], length)
+                                          : decodeSymbols(reader, table.entries(), &decoded[0], length);
+        Clock::time_point finished = Clock::now();
+        if (count != length) error("Profiled block did not decode to its own size.");
+
+        times.histogram += chrono::duration<double>(counted - before).count();
+        times.tree += chrono::duration<double>(built - counted).count();
+        times.codebook += chrono::duration<double>(coded - built).count();
+        times.encode += chrono::duration<double>(encoded - coded).count();
+        times.decode += chrono::duration<double>(finished - encoded).count();
+    }
+}
+
+/**
+ * Function: decodeInterleaved
+ * ---------------------------
+ * Decodes the streams of an interleaved block into their shares of out.  The main
+ * loop takes one table probe from each stream in turn.  The probes do not depend
+ * on one another, so the processor can overlap them instead of waiting for each
+ * code length before starting on the next lookup.  Each probe yields at most two
+ * characters, so as long as every stream has room for two more the loop runs
+ * without bounds checks, writing both slots and advancing by the entry's count.
+ * A pseudo-EOF there is an error, since no stream can end early.  The last few
+ * characters of each stream are decoded one stream at a time.
+ */
+void Encoding::decodeInterleaved(BitReader streams[], const Codeword codes[], char *out, int size) {
+    DecodeTable table;
+    table.build(codes);
+    const DecodeTable::Entry *entries = table.entries();
+    const uint32_t kEOFBits = (uint32_t(kPseudoEOF) << 16) | kPseudoEOF;
+
+    char *next[kNumStreams];
+    char *end[kNumStreams];
+    for (int k = 0; k < kNumStreams; k++) {
+        next[k] = out + segmentStart(size, k, kNumStreams);
+        end[k] = out + segmentStart(size, k + 1, kNumStreams);
+    }
+    while (true) {
+        long rounds = end[0] - next[0];
+        for (int k = 1; k < kNumStreams; k++) {
+            rounds = min(rounds, long(end[k] - next[k]));
+        }
+        rounds /= 2;
+        if (rounds == 0) break;
+        for (long round = 0; round < rounds; round++) {
+            for (int k = 0; k < kNumStreams; k++) {
+                DecodeTable::Entry entry = nextEntry(streams[k], entries);
+                if (entry.value & kEOFBits) error("Compressed block is corrupt.");
+                next[k][0] = (char) entry.value;
+                next[k][1] = (char) (entry.value >> 16);
+                next[k] += entry.count;
+            }
+        }
+    }
+    for (int k = 0; k < kNumStreams; k++) {
+        long left = end[k] - next[k];
+        if (decodeSymbols(streams[k], entries, next[k], left) != left) {
+            error("Compressed block is corrupt.");
         }
+    }
+}
 
+/**
+ * Function: readExtraBits
+ * -----------------------
+ * Reads the n extra bits that follow a length or distance symbol.
+ */
+static inline int readExtraBits(BitReader &bits, int n) {
+    int value = bits.peekBits(n);
+    bits.consume(n);
+    return value;
+}
+
+/**
+ * Function: copyMatch
+ * -------------------
+ * Copies length characters from distance characters back to out.  When the
+ * two overlap, the copy has to go a character at a time so that it repeats
+ * what it has just written.
+ */
+static inline void copyMatch(char *out, long distance, int length) {
+    const char *from = out - distance;
+    if (distance >= length) {
+        memcpy(out, from, length);
+        return;
+    }
+    for (int i = 0; i < length; i++) {
+        out[i] = from[i];
+    }
+}
+
+/**
+ * Function: decodeMatches
+ * -----------------------
+ * Decodes the tokens of a matched block with a table for each code.  Literals
+ * come out of the table one or two at a time as in decodeWithTable; a length
+ * symbol, which can only be the last one a probe resolves, is followed by its
+ * extra bits and the distance.  The distance table is built without pairs,
+ * since what follows a distance is never another distance.  Returns the number
+ * of characters decoded before the pseudo-EOF, raising an error for a match
+ * that reaches back before the block or past capacity.
+ */
+long Encoding::decodeMatches(BitReader &bits, const Codeword literalCodes[], const Codeword distanceCodes[],
+                             char *out, long capacity) {
+    DecodeTable literals, distances;
+    literals.build(literalCodes, kNumLiteralLengthSymbols);
+    distances.build(distanceCodes, kNumDistanceCodes, false);
+    const DecodeTable::Entry *literalEntries = literals.entries();
+    const DecodeTable::Entry *distanceEntries = distances.entries();
+    long decoded = 0;
+    while (true) {
+        DecodeTable::Entry entry = nextEntry(bits, literalEntries);
+        int symbol = entry.value & 0xFFFF;
+        if (symbol < kPseudoEOF) {
+            if (decoded == capacity) error("Compressed block is corrupt.");
+            out[decoded++] = (char) symbol;
+            if (entry.count == 1) continue;
+            symbol = entry.value >> 16;
+            if (symbol < kPseudoEOF) {
+                if (decoded == capacity) error("Compressed block is corrupt.");
+                out[decoded++] = (char) symbol;
+                continue;
+            }
+        }
+        if (symbol == kPseudoEOF) break;
+        const SymbolRange& lengthRange = kLengthRanges[symbol - kFirstLengthSymbol];
+        int length = lengthRange.base + readExtraBits(bits, lengthRange.extraBits);
+        const SymbolRange& distanceRange = kDistanceRanges[nextEntry(bits, distanceEntries).value];
+        long distance = distanceRange.base + readExtraBits(bits, distanceRange.extraBits);
+        if (distance > decoded || length > capacity - decoded) error("Compressed block is corrupt.");
+        copyMatch(out + decoded, distance, length);
+        decoded += length;
     }
+    return decoded;
 }
@@ -8,7 +8,12 @@
 #ifndef _encoding_
 #define _encoding_
 
+#include <future>
+#include <vector>
 #include "bstream.h"
+#include "codebook.h"
+#include "contexts.h"
+#include "lz77.h"
 #include "string.h"
 
 /*
@@ -20,6 +25,39 @@
  */
 class Encoding {
 public:
+    /*
+     * Type: DecoderKind
+     * -----------------
+     * Selects how decompress turns bits back into characters.  TABLE_LOOKUP
+     * resolves whole codewords through a DecodeTable and is the default;
+     * TREE_WALK follows the encoding tree one bit at a time and is kept as
+     * a reference point for benchmarks.
+     */
+    enum DecoderKind { TABLE_LOOKUP, TREE_WALK };
+
+    /*
+     * Type: EncoderKind
+     * -----------------
+     * Selects how compress writes codewords.  PACKED_CODES writes each
+     * character's whole code from the integer codebook and is the default;
+     * STRING_PATHS spells codes out as strings of '0' and '1' and writes them
+     * a bit at a time, and is kept as a reference point for benchmarks.
+     */
+    enum EncoderKind { PACKED_CODES, STRING_PATHS };
+
+    /*
+     * Type: StageTimes
+     * ----------------
+     * Seconds spent in each stage of coding, as measured by profileStages.
+     */
+    struct StageTimes {
+        double histogram;   /* counting characters */
+        double tree;        /* building code lengths from the counts */
+        double codebook;    /* assigning codes and building decode tables */
+        double encode;      /* writing payloads */
+        double decode;      /* reading payloads back */
+    };
+
     /*
      * Constructor: Encoding()
      * usage: Encoding encoding;
@@ -40,54 +78,314 @@ public:
      * Method: compress
      * usage: encoding.compress(filein, compressedout);
      * ----------------------------------
-     * Compresses a file, and stores the result in compressedout.
+     * Compresses a file, and stores the result in compressedout.  The file is
+     * read once, front to back, so it may be a pipe; if it was opened with
+     * openMapped, blocks are compressed straight from the mapping, starting at
+     * the current position, and no reads are made.  Blocks are compressed
+     * in parallel when more than one thread is allowed, and the output does
+     * not depend on the number of threads.  Returns the number of characters
+     * compressed.
      */
-    void compress(ibstream& infile, obstream& outfile);
+    uint64_t compress(ibstream& infile, obstream& outfile);
 
     /*
      * Method: decompress
      * usage: encoding.decompress(compressedin, decompressedout);
      * ----------------------------------
      * Deompresses compressedin, and stores the result in decompressedout.
+     * Blocks are decompressed in parallel when more than one thread is allowed.
      */
     void decompress(ibstream& infile, obstream& outfile);
 
+    /*
+     * Method: compress
+     * usage: encoding.compress(data, size, compressed);
+     *        size_t length = encoding.compress(data, size, out, capacity);
+     * ----------------------------------
+     * Compresses the size bytes at data, producing exactly what compressing a
+     * file holding those bytes would.  The first form replaces the contents of
+     * compressed with the result.  The second writes the result straight into
+     * the capacity bytes at out and returns its length; it raises an error if
+     * the result does not fit, which cannot happen when capacity is at least
+     * maxCompressedSize(size).
+     */
+    void compress(const char *data, size_t size, std::vector<char>& compressed);
+    size_t compress(const char *data, size_t size, char *out, size_t capacity);
+
+    /*
+     * Method: decompress
+     * usage: encoding.decompress(data, size, decompressed);
+     *        size_t length = encoding.decompress(data, size, out, capacity);
+     * ----------------------------------
+     * Decompresses the size bytes at data, which must hold a whole compressed
+     * file.  The first form replaces the contents of decompressed with the
+     * result.  The second writes the result straight into the capacity bytes
+     * at out and returns its length, raising an error if it does not fit;
+     * decompressedSize gives the capacity needed.
+     */
+    void decompress(const char *data, size_t size, std::vector<char>& decompressed);
+    size_t decompress(const char *data, size_t size, char *out, size_t capacity);
+
+    /*
+     * Method: maxCompressedSize
+     * usage: size_t capacity = encoding.maxCompressedSize(size);
+     * ----------------------------------
+     * Returns an upper bound on the compressed size of any size bytes with the
+     * current block size.
+     */
+    size_t maxCompressedSize(size_t size) const;
+
+    /*
+     * Method: decompressedSize
+     * usage: size_t size = encoding.decompressedSize(data, size);
+     * ----------------------------------
+     * Returns the number of bytes the compressed file held in the size bytes
+     * at data decompresses to, reading only the block headers.
+     */
+    size_t decompressedSize(const char *data, size_t size) const;
+
+    /*
+     * Method: decompressRange
+     * usage: encoding.decompressRange(compressedin, offset, length, out);
+     *        encoding.decompressRange(data, size, offset, length, out);
+     * ----------------------------------
+     * Replaces the contents of out with the length characters that start at
+     * offset in the decompressed file, decoding only the blocks they fall in.
+     * The blocks are found through the index at the end of the compressed
+     * file, so compressedin must be a seekable file or mapped; the second
+     * form takes a whole compressed file held in memory.  Every block the
+     * range touches is decoded in full, so the block size the file was
+     * compressed with sets the cost of a small read.  Raises an error if the
+     * range runs past the end of the file.
+     */
+    void decompressRange(ibstream& infile, uint64_t offset, size_t length, std::vector<char>& out);
+    void decompressRange(const char *data, size_t size, uint64_t offset, size_t length,
+                         std::vector<char>& out);
+
+    /*
+     * Method: profileStages
+     * usage: encoding.profileStages(data, size, times);
+     * ----------------------------------
+     * Codes the size bytes at data block by block, on the calling thread, and
+     * decodes each block again, adding the time spent in each stage to times.
+     * Blocks are character coded as a single stream whatever the level and
+     * setInterleaved say, and nothing is written out; the block size, code
+     * length limit, encoder, and decoder settings apply.  Raises an error if
+     * a block does not decode to the same number of characters.
+     */
+    void profileStages(const char *data, size_t size, StageTimes& times);
+
+    /*
+     * Method: setBlockSize
+     * usage: encoding.setBlockSize(1 << 16);
+     * ----------------------------------
+     * Sets how many characters compress reads and codes together.  Each block
+     * gets its own code and can be compressed and decompressed independently;
+     * about two blocks per thread are held in memory at a time.  The default
+     * is 1 MiB.
+     */
+    void setBlockSize(int bytes);
+
+    /*
+     * Method: setNumThreads
+     * usage: encoding.setNumThreads(4);
+     * ----------------------------------
+     * Sets how many threads compress and decompress may use to work on blocks.
+     * With one thread everything runs on the calling thread.  The default is
+     * the number of hardware threads.
+     */
+    void setNumThreads(int count);
+
+    /*
+     * Method: setMaxCodeLength
+     * usage: encoding.setMaxCodeLength(11);
+     * ----------------------------------
+     * Sets the longest code compress may assign, between kMinCodeLengthLimit
+     * and kMaxCodeLength bits.  Blocks whose Huffman code would be longer get
+     * the best code that fits instead.  Shorter limits keep decode tables
+     * small and each character within a bounded number of table probes, at a
+     * small cost in compression on very skewed input.  The default is 15.
+     */
+    void setMaxCodeLength(int bits);
+
+    /*
+     * Method: setLevel
+     * usage: encoding.setLevel(6);
+     * ----------------------------------
+     * Sets the compression level, from kMinLevel to kMaxLevel.  At level 0 each
+     * block is Huffman coded character by character.  Higher levels first look
+     * for repeated strings with an LZ77 match finder, searching harder the
+     * higher the level, and code the literals and matches with two Huffman
+     * codes of their own; a block is kept character coded when that comes out
+     * smaller.  Matched blocks ignore setInterleaved, setEncoder, and
+     * setDecoder, and their codes are at most 15 bits long.  The default is 0.
+     */
+    void setLevel(int level);
+
+    /*
+     * Method: setInterleaved
+     * usage: encoding.setInterleaved(true);
+     * ----------------------------------
+     * Chooses whether compress splits the payload of each block into four
+     * streams, one for each quarter of the block, so that the decoder can
+     * work on all four at once instead of following one long chain of codes.
+     * It costs a few bytes per block.  Files written either way decompress
+     * with any setting.  The default is a single stream.
+     */
+    void setInterleaved(bool enabled);
+
+    /*
+     * Method: setContextModeling
+     * usage: encoding.setContextModeling(true);
+     * ----------------------------------
+     * Chooses whether compress also tries coding each block with order-1
+     * context modeling: each character is coded with a code picked by the
+     * character before it, from up to kMaxContextGroups codes shared by
+     * contexts that behave alike.  A block is only kept that way when it
+     * comes out smaller, which text and logs usually do.  Decoding such a
+     * block switches code tables at every character and cannot decode two
+     * characters in one probe, so it is somewhat slower.  Context-modeled
+     * blocks ignore setInterleaved, setEncoder, and setDecoder, and their
+     * codes are at most 15 bits long.  The default is off.
+     */
+    void setContextModeling(bool enabled);
+
+    /*
+     * Method: setEncoder
+     * usage: encoding.setEncoder(Encoding::STRING_PATHS);
+     * ----------------------------------
+     * Chooses the encoding loop used by subsequent calls to compress.
+     */
+    void setEncoder(EncoderKind kind);
+
+    /*
+     * Method: setDecoder
+     * usage: encoding.setDecoder(Encoding::TREE_WALK);
+     * ----------------------------------
+     * Chooses the decoding strategy used by subsequent calls to decompress.
+     */
+    void setDecoder(DecoderKind kind);
 
 private:
     /* Private Structures */
 
-    struct LinkedNode {
-        int letter;
-        LinkedNode *left;
-        LinkedNode *right;
+    /*
+     * The nodes of one encoding tree, kept in fixed arrays and linked by
+     * index.  A tree over the largest alphabet has at most kMaxNodes nodes,
+     * so an arena lives on the stack of the block being coded and nothing is
+     * allocated or freed.  Node letters follow the original convention: a
+     * character or the pseudo-EOF at a leaf, kNoLetter at an internal node.
+     * child[node][bit] is the node reached by reading bit, or kNoNode.
+     */
+    struct TreeArena {
+        static const int kMaxNodes = 2 * kNumLiteralLengthSymbols - 1;
+        static const uint16_t kNoLetter = 0xFFFF;
+        static const uint16_t kNoNode = 0xFFFF;
+
+        uint16_t letter[kMaxNodes];
+        uint16_t child[kMaxNodes][2];
+        int size;
 
-        LinkedNode() {
-            letter = 257; /* 258 is larger than any ASCII value, so is a good representative of  */
-                          /* no value.  -1 would also be a good choice. */
-            left = NULL;
-            right = NULL;
-        }
-        LinkedNode(int l, LinkedNode* lft, LinkedNode* r){
-            letter = l;
-            left = lft;
-            right = r;
+        TreeArena() {
+            size = 0;
         }
+        int add(int l, int left, int right);
+    };
+
+    /*
+     * A block on its way through compress or decompress: input holds what was
+     * read, output what will be written, and done becomes ready once a worker
+     * has turned one into the other.  When compressing a mapped file, data and
+     * size point into the mapping and input is not used.
+     */
+    struct BlockJob {
+        const char *data;
+        int size;
+        std::vector<char> input;
+        std::vector<char> output;
+        std::future<void> done;
+    };
+
+    /*
+     * What compressing a block needs to know before writing it: the code for
+     * the block, and the exact number of bytes the block will take up.  A
+     * matched block also keeps its tokens, coded with the literal/length code
+     * in lengths and codes and with the distance code.  A context-modeled
+     * block keeps the group of each context, and a code for each group in
+     * groupLengths and groupCodes, kNumSymbols entries apiece.
+     */
+    static const int kNumStreams = 4;   /* payload streams in an interleaved block */
+
+    struct BlockPlan {
+        int lengths[kNumLiteralLengthSymbols];
+        Codeword codes[kNumLiteralLengthSymbols];
+        size_t bytes;
+        bool interleaved;
+        size_t streamBytes[kNumStreams];
+        bool matched;
+        std::vector<Token> tokens;
+        int distanceLengths[kNumDistanceCodes];
+        Codeword distanceCodes[kNumDistanceCodes];
+        bool contextual;
+        int numGroups;
+        uint8_t groups[kNumContexts];
+        std::vector<int> groupLengths;
+        std::vector<Codeword> groupCodes;
     };
 
-    struct entry {
-        LinkedNode * elem;
-        double priority;
+    /*
+     * Where one block of a compressed file held in memory sits, and where its
+     * characters go in the decompressed output.
+     */
+    struct BlockSpan {
+        const char *body;
+        uint32_t bodySize;
+        uint32_t size;
+        size_t offset;
     };
 
     /* Instance Variables */
-    LinkedNode * head;
-
-    std::string *array;
+    int blockSize;
+    int numThreads;
+    int maxCodeLength;
+    int level;
+    bool interleaved;
+    bool contextModeling;
+    EncoderKind encoder;
+    DecoderKind decoder;
 
 
     /* private function prototypes */
-    void fillArray(LinkedNode* head, std::string (&array)[257]);
-    void traverseTree(LinkedNode * head, std::string (&array)[257], std::string path);
+    void fillArray(const Codeword codes[], std::string (&array)[257]);
+    int buildTree(const Codeword codes[], TreeArena& tree);
+    void buildCodeLengths(const uint32_t counts[], int lengths[], int numSymbols = kNumSymbols);
+    void buildLimitedCodeLengths(const uint32_t counts[], int lengths[], int numSymbols, int limit);
+    int poolSize() const;
+    void planBlock(const char *data, int size, BlockPlan& plan);
+    void planMatchBlock(const char *data, int size, BlockPlan& plan);
+    void planContextBlock(const char *data, int size, BlockPlan& plan);
+    void writeBlock(const char *data, int size, const BlockPlan& plan, char *out);
+    void compressBlock(const char *data, int size, std::vector<char>& out);
+    size_t planBlocks(const char *data, size_t size, std::vector<BlockPlan>& plans,
+                      std::vector<std::pair<uint64_t, uint32_t> >& index, std::vector<char>& trailer);
+    void writeBlocks(const char *data, const std::vector<BlockPlan>& plans,
+                     const std::vector<std::pair<uint64_t, uint32_t> >& index,
+                     const std::vector<char>& trailer, char *out);
+    void findBlocks(const char *data, size_t size, std::vector<BlockSpan>& blocks) const;
+    void decodeBlocks(const std::vector<BlockSpan>& blocks, char *out);
+    void decodeRange(const std::vector<BlockSpan>& blocks, uint64_t skip, size_t length,
+                     std::vector<char>& out);
+    void decompressBlock(const char *body, int bodySize, char *out, int size);
+    void encodeSegment(const char *data, int size, BitWriter& bits, const Codeword codes[]);
+    void encodeWithCodes(const char *data, int size, BitWriter& bits, const Codeword codes[]);
+    void encodeWithStrings(const char *data, int size, BitWriter& bits, const Codeword codes[]);
+    long decodeWithTree(BitReader& bits, const TreeArena& tree, int head, char *out, long capacity);
+    long decodeWithTable(BitReader& bits, const Codeword codes[], char *out, long capacity);
+    void decodeInterleaved(BitReader streams[], const Codeword codes[], char *out, int size);
+    long decodeMatches(BitReader& bits, const Codeword literalCodes[], const Codeword distanceCodes[],
+                       char *out, long capacity);
+    long decodeContexts(BitReader& bits, const uint8_t groups[], int numGroups, const Codeword codes[],
+                        char *out, long capacity);
 };
 
 
@@ -0,0 +1,78 @@
+/**
+ * File: histogram.cpp
+ * -------------------
+ * Implementation of countBytes.
+ *
+ * A single table of counters runs slowly on repetitive data: when the same
+ * byte value comes up again before the previous increment of its counter
+ * has been stored, the load has to wait for that store.  Spreading the
+ * counting over kNumLanes tables, and sending consecutive bytes to
+ * different tables, keeps increments of the same counter apart.  Bytes are
+ * read eight at a time from a 64-bit word so that the loop does one load
+ * for every eight increments.
+ */
+
+#include <string.h>
+#include "histogram.h"
+
+static const int kNumLanes = 8;             /* interleaved sub-histograms */
+static const size_t kWordBytes = 8;
+static const size_t kMaxSlice = size_t(1) << 30; /* keeps every lane counter in 32 bits */
+
+/**
+ * Function: countSlice
+ * --------------------
+ * Counts one slice of at most kMaxSlice bytes into lanes.  Each byte of a
+ * word goes to lane (position % kNumLanes), and the shifts pick the bytes
+ * out in the same order whatever the machine's byte order.
+ */
+static void countSlice(const unsigned char *data, size_t size,
+                       uint32_t lanes[][kNumByteValues]) {
+    size_t i = 0;
+    for (; i + 2 * kWordBytes <= size; i += 2 * kWordBytes) {
+        uint64_t first, second;
+        memcpy(&first, data + i, kWordBytes);
+        memcpy(&second, data + i + kWordBytes, kWordBytes);
+        lanes[0][first & 0xFF]++;
+        lanes[1][(first >> 8) & 0xFF]++;
+        lanes[2][(first >> 16) & 0xFF]++;
+        lanes[3][(first >> 24) & 0xFF]++;
+        lanes[4][(first >> 32) & 0xFF]++;
+        lanes[5][(first >> 40) & 0xFF]++;
+        lanes[6][(first >> 48) & 0xFF]++;
+        lanes[7][first >> 56]++;
+        lanes[0][second & 0xFF]++;
+        lanes[1][(second >> 8) & 0xFF]++;
+        lanes[2][(second >> 16) & 0xFF]++;
+        lanes[3][(second >> 24) & 0xFF]++;
+        lanes[4][(second >> 32) & 0xFF]++;
+        lanes[5][(second >> 40) & 0xFF]++;
+        lanes[6][(second >> 48) & 0xFF]++;
+        lanes[7][second >> 56]++;
+    }
+    for (; i < size; i++) {
+        lanes[i % kNumLanes][data[i]]++;
+    }
+}
+
+/**
+ * Function: countBytes
+ * --------------------
+ * Counts each slice into zeroed lanes, then folds the lanes into counts.
+ */
+void countBytes(const char *data, size_t size, uint32_t counts[]) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    while (size > 0) {
+        size_t slice = size < kMaxSlice ? size : kMaxSlice;
+        uint32_t lanes[kNumLanes][kNumByteValues];
+        memset(lanes, 0, sizeof lanes);
+        countSlice(bytes, slice, lanes);
+        for (int lane = 0; lane < kNumLanes; lane++) {
+            for (int value = 0; value < kNumByteValues; value++) {
+                counts[value] += lanes[lane][value];
+            }
+        }
+        bytes += slice;
+        size -= slice;
+    }
+}
@@ -0,0 +1,32 @@
+/**
+ * File: histogram.h
+ * -----------------
+ * Defines countBytes, a fast byte-frequency counter.  The encoder uses it
+ * to size its codes, but it does not depend on anything Huffman-specific.
+ */
+
+#ifndef _histogram_
+#define _histogram_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The number of distinct byte values, and so the number of entries in a
+ * byte histogram.
+ */
+const int kNumByteValues = 256;
+
+/*
+ * Function: countBytes
+ * usage: countBytes(data, size, counts);
+ * --------------------------------------
+ * Adds the number of times each byte value appears in the size bytes at
+ * data to the matching entry of counts, which must have kNumByteValues
+ * entries.  Counts are added rather than stored so a histogram can be
+ * built up over several calls; clear counts first to start from zero.
+ * The caller must make sure the totals fit in 32 bits.
+ */
+void countBytes(const char *data, size_t size, uint32_t counts[]);
+
+#endif
@@ -6,11 +6,22 @@
 
 #include <iostream>
 #include "console.h"
+#include "batch.h"
+#include "benchmark.h"
 #include "encoding.h"
 #include "filelib.h"
 #include "simpio.h"
+#include "verify.h"
 using namespace std;
 
+/*
+ * The library headers rename main so that their own main can start the
+ * console before anything else runs.  Batch runs must not start it, so the
+ * rename is undone here and main decides for itself; see below.
+ */
+#undef main
+extern int startupMain(int argc, char **argv);
+
 // Function prototypes
 void simpleTest();
 void huffman();
@@ -19,11 +30,39 @@ static string selectFileToCompress();
 static string createCompressedFile();
 static string selectFileToDecompress();
 static string createDecompressedFile();
-int compareFiles(string fileOne, string fileTwo);
+long compareFiles(string fileOne, string fileTwo);
+
+/*
+ * Function: main
+ * --------------
+ * With arguments, runs them as a batch command without ever starting the
+ * console.  Without, does what the library's main would have done: hands
+ * over to its startup code, which opens the console window and calls Main.
+ */
+int main(int argc, char **argv) {
+    if (argc > 1) return runBatch(argc, argv);
+    return startupMain(argc, argv);
+}
 
-int main() {
+/*
+ * Function: Main
+ * --------------
+ * The interactive program, run in the console window.
+ */
+int Main() {
     // Remove the following function once your Encoding class is complete.
     //simpleTest();
+    // Uncomment to compare encoder and decoder throughput on the test file.
+    //benchmarkEncoders(Vector<string>(1, "testfile.txt"));
+    //benchmarkDecoders(Vector<string>(1, "testfile.txt"));
+    //benchmarkHistogram(Vector<string>(1, "testfile.txt"));
+    //reportCodeLengthLimits(Vector<string>(1, "testfile.txt"));
+    //benchmarkMappedInput(Vector<string>(1, "testfile.txt"));
+    //benchmarkThreads(Vector<string>(1, "testfile.txt"), 8);
+    //benchmarkLevels(Vector<string>(1, "testfile.txt"));
+    //benchmarkAdaptive(Vector<string>(1, "testfile.txt"));
+    //benchmarkRangeReads(Vector<string>(1, "testfile.txt"));
+    //benchmarkContexts(Vector<string>(1, "testfile.txt"));
     huffman();
 
 
@@ -75,7 +114,7 @@ void simpleTest() {
     decompressedout.close();
 
     // Compare original input to decompressed output
-    int errors = compareFiles(kTestFile, kTestDecompressed);
+    long errors = compareFiles(kTestFile, kTestDecompressed);
     if(errors == 0) cout << "Hooray! ";
     else cout << "Uh oh. " << endl;
     cout << "Files differ in " << errors << " bits." << endl;
@@ -95,7 +134,7 @@ void huffman() {
         if (responseIsAffirmative("Would you like to compress? (no will default to decompress) ")){
             string fileToCompress = selectFileToCompress(); /* compresses fileIn to compressedOut */
             ibstream fileIn;
-            fileIn.open(fileToCompress.c_str());
+            fileIn.openMapped(fileToCompress.c_str());
             string compressedFile = createCompressedFile();
             obstream compressedOut;
             compressedOut.open(compressedFile.c_str());
@@ -107,7 +146,7 @@ void huffman() {
         }else{
             string fileToDecompress = selectFileToDecompress(); /* decompresses compressedIn to decompressedOut */
             ibstream compressedIn;
-            compressedIn.open(fileToDecompress.c_str());
+            compressedIn.openMapped(fileToDecompress.c_str());
             string decompressedFile = createDecompressedFile();
             obstream decompressedOut;
             decompressedOut.open(decompressedFile.c_str());
@@ -229,18 +268,14 @@ static string createDecompressedFile(){
     return decompressedFile;
 }
 
-int compareFiles(string fileOne, string fileTwo) {
+/*
+ * function: compareFiles(fileOne, fileTwo)
+ * usage: long errors = compareFiles(fileOne, fileTwo);
+ * -------------------
+ * Returns the number of bits that differ between the two files.  Every bit of
+ * the longer file past the end of the shorter one counts as a difference.
+ */
+long compareFiles(string fileOne, string fileTwo) {
     cout << "Comparing " << fileOne << " to " << fileTwo << "." << endl;
-    int errors = 0;
-    ibstream one;
-    one.open(fileOne.c_str());
-    ibstream two;
-    two.open(fileTwo.c_str());
-    while(true) {
-        int obit = one.readbit();
-        int dbit = two.readbit();
-        if(obit != dbit) errors++;
-        if(obit == EOF && dbit == EOF) break;
-    }
-    return errors;
+    return countDifferingBits(fileOne, fileTwo);
 }
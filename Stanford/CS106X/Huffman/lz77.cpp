@@ -0,0 +1,215 @@
+/**
+ * File: lz77.cpp
+ * --------------
+ * Implementation of the match finder and the length and distance alphabets.
+ */
+
+#include <algorithm>
+#include "lz77.h"
+#include "error.h"
+using namespace std;
+
+static const int kHashBits = 15;
+static const int kHashSize = 1 << kHashBits;
+static const int kNoPosition = -1;
+
+/*
+ * The match lengths and distances covered by each symbol, as in deflate.
+ * Length 258 has a symbol of its own so that the longest match is cheap.
+ */
+const SymbolRange kLengthRanges[kNumLengthCodes] = {
+    {3, 0}, {4, 0}, {5, 0}, {6, 0}, {7, 0}, {8, 0}, {9, 0}, {10, 0},
+    {11, 1}, {13, 1}, {15, 1}, {17, 1}, {19, 2}, {23, 2}, {27, 2}, {31, 2},
+    {35, 3}, {43, 3}, {51, 3}, {59, 3}, {67, 4}, {83, 4}, {99, 4}, {115, 4},
+    {131, 5}, {163, 5}, {195, 5}, {227, 5}, {258, 0}
+};
+
+const SymbolRange kDistanceRanges[kNumDistanceCodes] = {
+    {1, 0}, {2, 0}, {3, 0}, {4, 0}, {5, 1}, {7, 1}, {9, 2}, {13, 2},
+    {17, 3}, {25, 3}, {33, 4}, {49, 4}, {65, 5}, {97, 5}, {129, 6}, {193, 6},
+    {257, 7}, {385, 7}, {513, 8}, {769, 8}, {1025, 9}, {1537, 9},
+    {2049, 10}, {3073, 10}, {4097, 11}, {6145, 11},
+    {8193, 12}, {12289, 12}, {16385, 13}, {24577, 13}
+};
+
+/*
+ * How hard each level looks: chain links followed per search, the match
+ * length that ends a search early, and whether matches may be deferred.
+ */
+struct LevelSettings {
+    int maxChain;
+    int niceLength;
+    bool lazy;
+};
+
+static const LevelSettings kLevels[kMaxLevel + 1] = {
+    {0, 0, false},
+    {4, 8, false}, {8, 16, false}, {16, 32, false},
+    {16, 32, true}, {32, 64, true}, {128, 128, true},
+    {256, 128, true}, {1024, kMaxMatch, true}, {4096, kMaxMatch, true}
+};
+
+/*
+ * Symbol lookup tables, filled in before main runs.  Distances up to 256 are
+ * looked up directly; above that every symbol covers a multiple of 128
+ * distances, so distance - 1 shifted right by 7 picks the entry.
+ */
+struct SymbolTables {
+    uint8_t lengths[kMaxMatch + 1];
+    uint8_t distances[512];
+
+    SymbolTables() {
+        for (int code = 0; code < kNumLengthCodes; code++) {
+            int base = kLengthRanges[code].base;
+            for (int i = 0; i < (1 << kLengthRanges[code].extraBits) && base + i <= kMaxMatch; i++) {
+                lengths[base + i] = code;
+            }
+        }
+        for (int code = 0; code < kNumDistanceCodes; code++) {
+            int base = kDistanceRanges[code].base;
+            for (int i = 0; i < (1 << kDistanceRanges[code].extraBits); i++) {
+                int d = base + i - 1;
+                if (d < 256) {
+                    distances[d] = code;
+                } else {
+                    distances[256 + (d >> 7)] = code;
+                }
+            }
+        }
+    }
+};
+
+static const SymbolTables kSymbolTables;
+
+/**
+ * Function: lengthCode
+ * --------------------
+ * Looks the length up in kSymbolTables.
+ */
+int lengthCode(int length) {
+    return kSymbolTables.lengths[length];
+}
+
+/**
+ * Function: distanceCode
+ * ----------------------
+ * Looks the distance up in kSymbolTables.
+ */
+int distanceCode(int distance) {
+    int d = distance - 1;
+    return d < 256 ? kSymbolTables.distances[d] : kSymbolTables.distances[256 + (d >> 7)];
+}
+
+/*
+ * Function: hashAt
+ * ----------------
+ * Hashes the kMinMatch characters starting at p.
+ */
+static inline int hashAt(const unsigned char *p) {
+    uint32_t key = uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16;
+    return (key * 2654435761u) >> (32 - kHashBits);
+}
+
+MatchFinder::MatchFinder(int level) {
+    if (level < kMinLevel || level > kMaxLevel) error("Compression level out of range.");
+    maxChain = kLevels[level].maxChain;
+    niceLength = kLevels[level].niceLength;
+    lazy = kLevels[level].lazy;
+    inserted = 0;
+}
+
+/**
+ * Method: findTokens
+ * ------------------
+ * Emits a literal wherever no match of kMinMatch characters is found, and
+ * otherwise the longest match the chains turn up.  With lazy matching, a
+ * match shorter than niceLength is held back while the next position has a
+ * longer one, emitting a literal for each position given up.
+ */
+void MatchFinder::findTokens(const char *data, int size, vector<Token>& tokens) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    tokens.clear();
+    if (maxChain == 0) {
+        for (int pos = 0; pos < size; pos++) {
+            Token literal = {0, bytes[pos]};
+            tokens.push_back(literal);
+        }
+        return;
+    }
+    head.assign(kHashSize, kNoPosition);
+    prev.resize(kMaxDistance);
+    inserted = 0;
+
+    int pos = 0;
+    while (pos < size) {
+        int distance;
+        int length = longestMatch(bytes, size, pos, distance);
+        while (lazy && length >= kMinMatch && length < niceLength) {
+            int nextDistance;
+            int nextLength = longestMatch(bytes, size, pos + 1, nextDistance);
+            if (nextLength <= length) break;
+            Token literal = {0, bytes[pos]};
+            tokens.push_back(literal);
+            pos++;
+            length = nextLength;
+            distance = nextDistance;
+        }
+        if (length >= kMinMatch) {
+            Token match = {uint16_t(length), uint16_t(distance)};
+            tokens.push_back(match);
+            pos += length;
+        } else {
+            Token literal = {0, bytes[pos]};
+            tokens.push_back(literal);
+            pos++;
+        }
+    }
+}
+
+/**
+ * Method: insertUpTo
+ * ------------------
+ * Files every position from inserted up to end in the hash chains.  The
+ * last kMinMatch - 1 positions of the block have nothing to hash.
+ */
+void MatchFinder::insertUpTo(const unsigned char *data, int size, int end) {
+    end = min(end, size - kMinMatch + 1);
+    for (; inserted < end; inserted++) {
+        int hash = hashAt(data + inserted);
+        prev[inserted & (kMaxDistance - 1)] = head[hash];
+        head[hash] = inserted;
+    }
+}
+
+/**
+ * Method: longestMatch
+ * --------------------
+ * Walks the chain for pos, oldest positions last, and returns the length of
+ * the longest match found, storing its distance.  Each candidate is first
+ * checked at the character that would make it beat the best so far, which
+ * rules most of them out with a single comparison.  Returns 0 if there is no
+ * match of at least kMinMatch characters.
+ */
+int MatchFinder::longestMatch(const unsigned char *data, int size, int pos, int& distance) {
+    insertUpTo(data, size, pos);
+    int limit = min(kMaxMatch, size - pos);
+    if (limit < kMinMatch) return 0;
+    int best = kMinMatch - 1;
+    int candidate = head[hashAt(data + pos)];
+    const unsigned char *target = data + pos;
+    for (int chain = maxChain; chain > 0 && candidate != kNoPosition; chain--) {
+        if (pos - candidate > kMaxDistance) break;
+        const unsigned char *source = data + candidate;
+        if (source[best] == target[best] && source[0] == target[0]) {
+            int length = 1;
+            while (length < limit && source[length] == target[length]) length++;
+            if (length > best) {
+                best = length;
+                distance = pos - candidate;
+                if (length >= niceLength || length == limit) break;
+            }
+        }
+        candidate = prev[candidate & (kMaxDistance - 1)];
+    }
+    return best >= kMinMatch ? best : 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * File: lz77.h
+ * ------------
+ * Defines the LZ77 stage that can run ahead of the Huffman coder: a match
+ * finder that turns a block into literal and match tokens, and the symbol
+ * alphabets those tokens are coded with.  The alphabets are the ones used
+ * by deflate, so lengths run from 3 to 258 and distances reach back 32 KiB.
+ */
+
+#ifndef _lz77_
+#define _lz77_
+
+#include <stdint.h>
+#include <vector>
+#include "codebook.h"
+
+/* Matches are at least kMinMatch and at most kMaxMatch characters long. */
+const int kMinMatch = 3;
+const int kMaxMatch = 258;
+
+/* The farthest back a match may start, which is also the window size. */
+const int kMaxDistance = 32768;
+
+/*
+ * The literal/length alphabet is the byte values, the pseudo-EOF, and then
+ * kNumLengthCodes symbols, each covering a range of match lengths.  The
+ * distance alphabet has kNumDistanceCodes symbols covering ranges of
+ * distances.  A symbol's extra bits select the value within its range.
+ */
+const int kNumLengthCodes = 29;
+const int kFirstLengthSymbol = kPseudoEOF + 1;
+const int kNumLiteralLengthSymbols = kFirstLengthSymbol + kNumLengthCodes;
+const int kNumDistanceCodes = 30;
+
+/* Compression levels accepted by MatchFinder; level 0 finds no matches. */
+const int kMinLevel = 0;
+const int kMaxLevel = 9;
+
+/*
+ * Type: Token
+ * -----------
+ * One step of a block.  A length of zero means the literal character
+ * value; otherwise the step copies length characters from value
+ * characters back.
+ */
+struct Token {
+    uint16_t length;
+    uint16_t value;
+};
+
+/*
+ * Type: SymbolRange
+ * -----------------
+ * The first value a length or distance symbol stands for, and the number
+ * of extra bits that follow the symbol to pick a value from its range.
+ */
+struct SymbolRange {
+    uint16_t base;
+    uint8_t extraBits;
+};
+
+extern const SymbolRange kLengthRanges[kNumLengthCodes];
+extern const SymbolRange kDistanceRanges[kNumDistanceCodes];
+
+/*
+ * Function: lengthCode
+ * usage: int code = lengthCode(length);
+ * -------------------------------------
+ * Returns the index into kLengthRanges for a match length; the symbol in
+ * the literal/length alphabet is kFirstLengthSymbol plus the index.
+ */
+int lengthCode(int length);
+
+/*
+ * Function: distanceCode
+ * usage: int code = distanceCode(distance);
+ * -----------------------------------------
+ * Returns the distance symbol, an index into kDistanceRanges, for a match
+ * distance between 1 and kMaxDistance.
+ */
+int distanceCode(int distance);
+
+/*
+ * Class: MatchFinder
+ * ------------------
+ * Finds matches with hash chains: every position is filed under a hash of
+ * its first kMinMatch characters, and the positions with the same hash are
+ * linked from newest to oldest.  The level sets how far down a chain the
+ * finder looks and whether it tries deferring a match by one character in
+ * case a longer one starts there.  A finder holds its tables between calls
+ * but each call only matches within its own block, so a finder can be used
+ * for any number of blocks, one at a time.
+ */
+class MatchFinder {
+public:
+    /*
+     * Constructor: MatchFinder(level)
+     * usage: MatchFinder finder(6);
+     * --------------------------------
+     * Sets up a finder for a level between kMinLevel and kMaxLevel.
+     */
+    explicit MatchFinder(int level);
+
+    /*
+     * Method: findTokens
+     * usage: finder.findTokens(data, size, tokens);
+     * --------------------------------
+     * Replaces tokens with a parse of the size characters at data.  Copying
+     * out the tokens in order rebuilds the data.
+     */
+    void findTokens(const char *data, int size, std::vector<Token>& tokens);
+
+private:
+    int maxChain;               /* chain links followed per search */
+    int niceLength;             /* a match this long ends the search */
+    bool lazy;                  /* whether to try deferring each match */
+    std::vector<int32_t> head;  /* newest position for each hash, or -1 */
+    std::vector<int32_t> prev;  /* next older position, by position mod kMaxDistance */
+    int inserted;               /* positions below this are in the chains */
+
+    void insertUpTo(const unsigned char *data, int size, int end);
+    int longestMatch(const unsigned char *data, int size, int pos, int& distance);
+};
+
+#endif
@@ -0,0 +1,368 @@
+/**
+ * File: suite.cpp
+ * ---------------
+ * Implementation of the benchmark suite.  Every measurement is repeated
+ * until it has taken at least kMinSeconds, so that the small corpora are
+ * timed over many runs and the large ones over one.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "suite.h"
+#include "benchmark.h"
+#include "cmdline.h"
+#include "corpus.h"
+#include "encoding.h"
+#include "error.h"
+#include "map.h"
+#include "strlib.h"
+#include "verify.h"
+using namespace std;
+
+static const size_t kMinCorpusSize = 1 << 10;
+static const size_t kMaxCorpusSize = size_t(1) << 30;
+static const int kSizeStep = 32;                    /* each corpus size is this many times the last */
+static const int kDefaultMaxSize = 32 << 20;
+static const double kMinSeconds = 0.25;
+static const int kNumTimes = 7;                     /* times recorded for each corpus */
+static const int kUsageError = 2;
+static const int kSmallBlockSize = 4096;            /* gives even the 1 KiB corpus a full block */
+static const char *const kTimeNames[kNumTimes] = {
+    "histogram", "tree", "codebook", "encode", "decode", "compress", "decompress"
+};
+
+/*
+ * The results for one corpus.  times holds the seconds taken by one pass
+ * of each stage, in the order of kTimeNames; the last two are whole
+ * compression and decompression.
+ */
+struct SuiteResult {
+    string corpus;
+    size_t bytes;
+    size_t compressed;
+    double times[kNumTimes];
+};
+
+struct SuiteOptions {
+    size_t maxSize;
+    uint64_t seed;
+    string wordsFile;
+    string outputFile;
+    string baselineFile;
+};
+
+/**
+ * Function: parseOptions
+ * ----------------------
+ * Fills in options from argv, after the command, raising an error for
+ * anything it does not recognize.
+ */
+static void parseOptions(int argc, char **argv, SuiteOptions& options) {
+    options.maxSize = kDefaultMaxSize;
+    options.seed = 1;
+    options.wordsFile = "EnglishWords.dat";
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg != "-m" && arg != "-s" && arg != "-w" && arg != "-o" && arg != "-B") {
+            error("Unknown option " + arg + ".");
+        }
+        if (i + 1 == argc) error("Option " + arg + " needs a value.");
+        string value = argv[++i];
+        if (arg == "-m") {
+            int size = parseInteger(value, "Option -m");
+            if (size < int(kMinCorpusSize)) error("Largest corpus must be at least 1024 bytes.");
+            options.maxSize = size;
+        } else if (arg == "-s") {
+            int seed = parseInteger(value, "Option -s");
+            if (seed < 0) error("Seed must not be negative.");
+            options.seed = seed;
+        } else if (arg == "-w") {
+            options.wordsFile = value;
+        } else if (arg == "-o") {
+            options.outputFile = value;
+        } else {
+            options.baselineFile = value;
+        }
+    }
+}
+
+/**
+ * Function: measureStages
+ * -----------------------
+ * Fills in the stage times of result with the average of as many
+ * profileStages passes as fit in kMinSeconds.
+ */
+static void measureStages(const vector<char>& data, SuiteResult& result) {
+    Encoding encoding;
+    encoding.setNumThreads(1);
+    Encoding::StageTimes total = {0, 0, 0, 0, 0};
+    int passes = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    do {
+        encoding.profileStages(&data[0], data.size(), total);
+        passes++;
+    } while (secondsSince(start) < kMinSeconds);
+    result.times[0] = total.histogram / passes;
+    result.times[1] = total.tree / passes;
+    result.times[2] = total.codebook / passes;
+    result.times[3] = total.encode / passes;
+    result.times[4] = total.decode / passes;
+}
+
+/**
+ * Function: measureCodec
+ * ----------------------
+ * Fills in the compressed size and the best whole compression and
+ * decompression times, running each until it has taken kMinSeconds.
+ * Raises an error if the round trip does not give back the corpus.
+ */
+static void measureCodec(const vector<char>& data, SuiteResult& result) {
+    Encoding encoding;
+    vector<char> compressed;
+    double total = 0;
+    result.times[5] = 0;
+    do {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        encoding.compress(&data[0], data.size(), compressed);
+        double seconds = secondsSince(start);
+        if (total == 0 || seconds < result.times[5]) result.times[5] = seconds;
+        total += seconds;
+    } while (total < kMinSeconds);
+
+    vector<char> decompressed;
+    total = 0;
+    result.times[6] = 0;
+    do {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        encoding.decompress(&compressed[0], compressed.size(), decompressed);
+        double seconds = secondsSince(start);
+        if (total == 0 || seconds < result.times[6]) result.times[6] = seconds;
+        total += seconds;
+    } while (total < kMinSeconds);
+
+    if (decompressed.size() != data.size()
+            || countDifferingBits(&data[0], &decompressed[0], data.size()) != 0) {
+        error("The " + result.corpus + " corpus did not survive a round trip.");
+    }
+    result.compressed = compressed.size();
+}
+
+/**
+ * Function: checkBound
+ * --------------------
+ * Compresses the corpus straight into a buffer of exactly maxCompressedSize
+ * bytes, with and without interleaving and with the default and a small
+ * block size, raising an error if any result does not fit.  The uniform
+ * corpus, which does not compress, is the one that tests the bound.
+ */
+static void checkBound(const vector<char>& data, const SuiteResult& result) {
+    vector<char> out;
+    for (int interleaved = 0; interleaved < 2; interleaved++) {
+        for (int small = 0; small < 2; small++) {
+            Encoding encoding;
+            encoding.setInterleaved(interleaved);
+            if (small) encoding.setBlockSize(kSmallBlockSize);
+            out.resize(encoding.maxCompressedSize(data.size()));
+            try {
+                encoding.compress(&data[0], data.size(), &out[0], out.size());
+            } catch (ErrorException& ex) {
+                error("The " + result.corpus + " corpus does not fit in maxCompressedSize"
+                      + string(interleaved ? " when interleaved" : "") + ": " + ex.getMessage());
+            }
+        }
+    }
+}
+
+/**
+ * Function: printHeader, printResult
+ * ----------------------------------
+ * Print the results table on cout.  Stage times are in microseconds per
+ * pass over the corpus; whole compression and decompression in MB/s.
+ */
+static void printHeader() {
+    cout << left << setw(8) << "corpus" << right << setw(11) << "bytes" << setw(7) << "ratio";
+    for (int i = 0; i < kNumTimes - 2; i++) {
+        cout << setw(12) << kTimeNames[i];
+    }
+    cout << setw(11) << "comp MB/s" << setw(11) << "dec MB/s" << endl;
+}
+
+static void printResult(const SuiteResult& result) {
+    cout << left << setw(8) << result.corpus << right << setw(11) << result.bytes
+         << setw(7) << setprecision(3) << double(result.compressed) / result.bytes
+         << setprecision(1);
+    for (int i = 0; i < kNumTimes - 2; i++) {
+        cout << setw(12) << result.times[i] * 1e6;
+    }
+    for (int i = kNumTimes - 2; i < kNumTimes; i++) {
+        cout << setw(11) << result.bytes / result.times[i] / (1 << 20);
+    }
+    cout << endl;
+}
+
+/**
+ * Function: writeCSV
+ * ------------------
+ * Writes one line per corpus, after a header line naming the columns.
+ * Times are in seconds.
+ */
+static void writeCSV(ostream& out, const vector<SuiteResult>& results) {
+    out << "corpus,bytes,compressed_bytes";
+    for (int i = 0; i < kNumTimes; i++) {
+        out << "," << kTimeNames[i] << "_seconds";
+    }
+    out << "\n" << setprecision(9);
+    for (size_t r = 0; r < results.size(); r++) {
+        const SuiteResult& result = results[r];
+        out << result.corpus << "," << result.bytes << "," << result.compressed;
+        for (int i = 0; i < kNumTimes; i++) {
+            out << "," << result.times[i];
+        }
+        out << "\n";
+    }
+}
+
+/**
+ * Function: writeJSON
+ * -------------------
+ * Writes the seed and an array with an object for each corpus, with the
+ * same fields as the CSV.
+ */
+static void writeJSON(ostream& out, const SuiteOptions& options, const vector<SuiteResult>& results) {
+    out << "{\n  \"seed\": " << options.seed << ",\n  \"results\": [" << setprecision(9);
+    for (size_t r = 0; r < results.size(); r++) {
+        const SuiteResult& result = results[r];
+        out << (r == 0 ? "\n" : ",\n") << "    {\"corpus\": \"" << result.corpus
+            << "\", \"bytes\": " << result.bytes << ", \"compressed_bytes\": " << result.compressed;
+        for (int i = 0; i < kNumTimes; i++) {
+            out << ", \"" << kTimeNames[i] << "_seconds\": " << result.times[i];
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/**
+ * Function: writeResults
+ * ----------------------
+ * Writes the results to the named file in the format its name calls for.
+ */
+static void writeResults(const SuiteOptions& options, const vector<SuiteResult>& results) {
+    ofstream out(options.outputFile.c_str());
+    if (!out.is_open()) error("Cannot write " + options.outputFile + ".");
+    if (endsWith(options.outputFile, ".json")) {
+        writeJSON(out, options, results);
+    } else {
+        writeCSV(out, results);
+    }
+    if (!out) error("Cannot write " + options.outputFile + ".");
+}
+
+/**
+ * Function: readBaseline
+ * ----------------------
+ * Reads a CSV written by writeCSV into a map from "corpus/bytes" to the
+ * result, skipping the header line.
+ */
+static Map<string, SuiteResult> readBaseline(const string& filename) {
+    ifstream csv(filename.c_str());
+    if (!csv.is_open()) error("Cannot read " + filename + ".");
+    Map<string, SuiteResult> baseline;
+    string line;
+    getline(csv, line);
+    while (getline(csv, line)) {
+        if (trim(line).empty()) continue;
+        istringstream fields(line);
+        string field;
+        vector<string> values;
+        while (getline(fields, field, ',')) values.push_back(field);
+        if (values.size() != size_t(3 + kNumTimes)) error(filename + " is not a suite CSV file.");
+        SuiteResult result;
+        result.corpus = values[0];
+        result.bytes = parseReal(values[1], "A field of " + filename);
+        result.compressed = parseReal(values[2], "A field of " + filename);
+        for (int i = 0; i < kNumTimes; i++) {
+            result.times[i] = parseReal(values[3 + i], "A field of " + filename);
+        }
+        baseline.put(result.corpus + "/" + values[1], result);
+    }
+    return baseline;
+}
+
+/**
+ * Function: compareWithBaseline
+ * -----------------------------
+ * For each corpus in the baseline, prints the change in compressed size
+ * and, for each time, how many times faster it is now: above 1 is faster.
+ */
+static void compareWithBaseline(const string& filename, const vector<SuiteResult>& results) {
+    Map<string, SuiteResult> baseline = readBaseline(filename);
+    cout << endl << "Compared with " << filename << " (speedup, above 1 is faster):" << endl;
+    for (size_t r = 0; r < results.size(); r++) {
+        const SuiteResult& result = results[r];
+        string key = result.corpus + "/" + integerToString(result.bytes);
+        if (!baseline.containsKey(key)) continue;
+        const SuiteResult& before = baseline[key];
+        cout << left << setw(8) << result.corpus << right << setw(11) << result.bytes
+             << "  size " << showpos << setprecision(2)
+             << 100.0 * (double(result.compressed) - before.compressed) / before.compressed
+             << noshowpos << "%";
+        for (int i = 0; i < kNumTimes; i++) {
+            if (result.times[i] > 0) {
+                cout << "  " << kTimeNames[i] << " " << before.times[i] / result.times[i] << "x";
+            }
+        }
+        cout << endl;
+    }
+}
+
+/**
+ * Function: runSuite
+ * ------------------
+ * Loads the word list first, so that a missing file is reported before
+ * any time is spent, then works through the corpora by kind and size.
+ */
+int runSuite(int argc, char **argv) {
+    SuiteOptions options;
+    try {
+        parseOptions(argc, argv, options);
+    } catch (ErrorException& ex) {
+        cerr << ex.getMessage() << endl
+             << "usage: huffman suite [-m maxBytes] [-s seed] [-w words] [-o results.csv|.json]"
+                " [-B baseline.csv]" << endl;
+        return kUsageError;
+    }
+    try {
+        CorpusGenerator generator(options.seed);
+        generator.loadWords(options.wordsFile);
+        vector<SuiteResult> results;
+        vector<char> data;
+        cout << fixed;
+        printHeader();
+        for (int kind = 0; kind < kNumCorpusKinds; kind++) {
+            for (size_t size = kMinCorpusSize; size <= options.maxSize && size <= kMaxCorpusSize;
+                 size *= kSizeStep) {
+                generator.generate(CorpusKind(kind), size, data);
+                SuiteResult result;
+                result.corpus = corpusName(CorpusKind(kind));
+                result.bytes = size;
+                measureStages(data, result);
+                measureCodec(data, result);
+                checkBound(data, result);
+                printResult(result);
+                results.push_back(result);
+            }
+        }
+        if (!options.outputFile.empty()) writeResults(options, results);
+        if (!options.baselineFile.empty()) compareWithBaseline(options.baselineFile, results);
+    } catch (ErrorException& ex) {
+        cerr << ex.getMessage() << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
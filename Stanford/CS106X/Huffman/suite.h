@@ -0,0 +1,39 @@
+/**
+ * File: suite.h
+ * -------------
+ * The benchmark suite, run as "huffman suite [options]".  It generates a
+ * corpus of each kind CorpusGenerator knows, at sizes from 1 KiB up, and
+ * for each one measures the stages of coding separately (histogram, code
+ * lengths, codebook, encode, decode) on one thread, then whole in-memory
+ * compression and decompression with the default settings.  Each corpus is
+ * also compressed into a buffer of exactly maxCompressedSize bytes, with and
+ * without interleaving, to check that bound.  The options are
+ *
+ *     -m bytes     largest corpus; sizes go up by 32 times from 1 KiB to
+ *                  1 GiB (default 32 MiB).  A corpus is held in memory
+ *                  three times over while it is measured.
+ *     -s seed      seed for the corpus (default 1)
+ *     -w file      lexicon for the English corpus (default EnglishWords.dat)
+ *     -o file      also write the results to file, as JSON if its name
+ *                  ends in .json and as CSV otherwise
+ *     -B file      compare with results written earlier as CSV, printing
+ *                  how many times faster each stage is now
+ *
+ * Keeping the CSV from a known good build and passing it to -B makes any
+ * change measurable against it.
+ */
+
+#ifndef _suite_
+#define _suite_
+
+/*
+ * Function: runSuite
+ * usage: return runSuite(argc, argv);
+ * --------------------------------
+ * Runs the suite with the options in argv, which starts with the program
+ * name and "suite", and returns the exit status for main: 0 on success, 1
+ * if something failed, and 2 if the options could not be understood.
+ */
+int runSuite(int argc, char **argv);
+
+#endif
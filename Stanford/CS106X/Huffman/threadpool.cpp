@@ -0,0 +1,67 @@
+/**
+ * File: threadpool.cpp
+ * --------------------
+ * Implementation of the ThreadPool class.
+ */
+
+#include "threadpool.h"
+using namespace std;
+
+ThreadPool::ThreadPool(int numThreads) : stopping(false) {
+    for (int i = 0; i < numThreads; i++) {
+        workers.push_back(thread(&ThreadPool::run, this));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        tasks.clear();
+    }
+    ready.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+/**
+ * Method: submit
+ * --------------
+ * Wraps the task so that its result, or the exception it throws, ends up in
+ * the returned future.  Without workers the task runs right away.
+ */
+future<void> ThreadPool::submit(const function<void()>& task) {
+    packaged_task<void()> job(task);
+    future<void> done = job.get_future();
+    if (workers.empty()) {
+        job();
+        return done;
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        tasks.push_back(move(job));
+    }
+    ready.notify_one();
+    return done;
+}
+
+/**
+ * Method: run
+ * -----------
+ * The loop each worker runs: wait for a task, take it off the queue, and run
+ * it outside the lock.
+ */
+void ThreadPool::run() {
+    while (true) {
+        packaged_task<void()> job;
+        {
+            unique_lock<mutex> guard(lock);
+            ready.wait(guard, [this] { return stopping || !tasks.empty(); });
+            if (stopping) return;
+            job = move(tasks.front());
+            tasks.pop_front();
+        }
+        job();
+    }
+}
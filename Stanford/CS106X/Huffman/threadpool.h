@@ -0,0 +1,67 @@
+/**
+ * File: threadpool.h
+ * ------------------
+ * Defines the ThreadPool class, a fixed set of worker threads that run
+ * tasks handed to them in the order they were submitted.
+ */
+
+#ifndef _threadpool_
+#define _threadpool_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Class: ThreadPool
+ * -----------------
+ * Each call to submit queues a task and returns a future that becomes ready
+ * when the task has run.  Calling get on the future rethrows anything the
+ * task threw, so errors raised on a worker reach the thread that waits for
+ * the result.  A pool with no workers runs each task inside submit.
+ */
+class ThreadPool {
+public:
+    /*
+     * Constructor: ThreadPool(numThreads)
+     * usage: ThreadPool pool(4);
+     * --------------------------------
+     * Starts numThreads worker threads.
+     */
+    explicit ThreadPool(int numThreads);
+
+    /*
+     * Destructor: ~ThreadPool()
+     * usage: (usually implicit)
+     * --------------------------------
+     * Lets tasks that are running finish, drops the ones still queued, and
+     * joins the workers.  Futures for dropped tasks report a broken promise.
+     */
+    ~ThreadPool();
+
+    /*
+     * Method: submit
+     * usage: std::future<void> done = pool.submit(task);
+     * --------------------------------
+     * Queues task to run on the next free worker.
+     */
+    std::future<void> submit(const std::function<void()>& task);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::packaged_task<void()> > tasks;
+    std::mutex lock;
+    std::condition_variable ready;
+    bool stopping;
+
+    void run();
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+};
+
+#endif
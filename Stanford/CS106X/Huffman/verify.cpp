@@ -0,0 +1,187 @@
+/**
+ * File: verify.cpp
+ * ----------------
+ * Implementation of the bit counter and the checksum.
+ *
+ * Round trips are expected to match, so the bit counter first compares each
+ * slice with memcmp, which runs at memory speed, and only counts bits in
+ * slices that differ: eight bytes at a time, as the population count of
+ * the two words XORed together.  The CRC uses slicing by eight: eight
+ * tables, each giving the effect of a byte followed by a different number
+ * of zero bytes, let it fold in eight bytes with eight independent lookups
+ * instead of eight dependent ones.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+#include <vector>
+#include "verify.h"
+#include "error.h"
+using namespace std;
+
+static const size_t kSliceSize = 4096;          /* bytes compared by each memcmp */
+static const size_t kWordBytes = 8;
+static const size_t kReadSize = size_t(1) << 20; /* bytes read from a file at a time */
+static const uint32_t kCrcPolynomial = 0xEDB88320;  /* reflected, as zlib has it */
+
+/*
+ * Function: popcount
+ * ------------------
+ * Returns the number of set bits in word.
+ */
+static inline int popcount(uint64_t word) {
+#ifdef __GNUC__
+    return __builtin_popcountll(word);
+#else
+    word -= (word >> 1) & 0x5555555555555555ULL;
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return int((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * Function: countSliceBits
+ * ------------------------
+ * Counts the differing bits in a slice already known to differ.
+ */
+static long countSliceBits(const char *one, const char *two, size_t size) {
+    long errors = 0;
+    size_t i = 0;
+    for (; i + kWordBytes <= size; i += kWordBytes) {
+        uint64_t a, b;
+        memcpy(&a, one + i, kWordBytes);
+        memcpy(&b, two + i, kWordBytes);
+        errors += popcount(a ^ b);
+    }
+    for (; i < size; i++) {
+        errors += popcount((unsigned char) (one[i] ^ two[i]));
+    }
+    return errors;
+}
+
+long countDifferingBits(const char *one, const char *two, size_t size) {
+    long errors = 0;
+    for (size_t pos = 0; pos < size; pos += kSliceSize) {
+        size_t slice = min(kSliceSize, size - pos);
+        if (memcmp(one + pos, two + pos, slice) != 0) {
+            errors += countSliceBits(one + pos, two + pos, slice);
+        }
+    }
+    return errors;
+}
+
+/**
+ * Function: openForReading
+ * ------------------------
+ * Opens the named file as raw bytes, raising an error if it cannot.
+ */
+static void openForReading(ifstream& stream, const string& name) {
+    stream.open(name.c_str(), ios::binary);
+    if (!stream.is_open()) error("Cannot open " + name + ".");
+}
+
+/**
+ * Function: readBlock
+ * -------------------
+ * Reads up to kReadSize bytes into buffer and returns how many it got,
+ * which is less than kReadSize only at the end of the file.
+ */
+static size_t readBlock(ifstream& stream, vector<char>& buffer) {
+    stream.read(&buffer[0], kReadSize);
+    return stream.gcount();
+}
+
+/**
+ * Function: countDifferingBits
+ * ----------------------------
+ * Reads the files in step.  Once the shorter one runs out, every byte the
+ * longer one still gives counts eight bits.
+ */
+long countDifferingBits(const string& fileOne, const string& fileTwo) {
+    ifstream one, two;
+    openForReading(one, fileOne);
+    openForReading(two, fileTwo);
+    vector<char> bufferOne(kReadSize), bufferTwo(kReadSize);
+    long errors = 0;
+    while (true) {
+        size_t sizeOne = readBlock(one, bufferOne);
+        size_t sizeTwo = readBlock(two, bufferTwo);
+        if (sizeOne == 0 && sizeTwo == 0) break;
+        size_t common = min(sizeOne, sizeTwo);
+        errors += countDifferingBits(&bufferOne[0], &bufferTwo[0], common);
+        errors += 8 * long(max(sizeOne, sizeTwo) - common);
+    }
+    return errors;
+}
+
+/*
+ * The slicing tables, filled in before main runs.  tables[0] is the usual
+ * byte-at-a-time table; tables[k] gives the CRC of a byte followed by k
+ * zero bytes.
+ */
+struct CrcTables {
+    uint32_t tables[8][256];
+
+    CrcTables() {
+        for (int byte = 0; byte < 256; byte++) {
+            uint32_t crc = byte;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (crc & 1 ? kCrcPolynomial : 0);
+            }
+            tables[0][byte] = crc;
+        }
+        for (int byte = 0; byte < 256; byte++) {
+            for (int k = 1; k < 8; k++) {
+                uint32_t previous = tables[k - 1][byte];
+                tables[k][byte] = (previous >> 8) ^ tables[0][previous & 0xFF];
+            }
+        }
+    }
+};
+
+static const CrcTables kCrcTables;
+
+Checksum::Checksum() {
+    crc = 0xFFFFFFFF;
+}
+
+/**
+ * Method: update
+ * --------------
+ * Folds in eight bytes at a time and then the last few one at a time.  The
+ * first four bytes of each eight are combined with the CRC so far, so they
+ * are looked up as if followed by the other four plus their own offset.
+ */
+void Checksum::update(const char *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    const uint32_t (*t)[256] = kCrcTables.tables;
+    uint32_t c = crc;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        c ^= uint32_t(bytes[i]) | uint32_t(bytes[i + 1]) << 8
+           | uint32_t(bytes[i + 2]) << 16 | uint32_t(bytes[i + 3]) << 24;
+        c = t[7][c & 0xFF] ^ t[6][(c >> 8) & 0xFF] ^ t[5][(c >> 16) & 0xFF] ^ t[4][c >> 24]
+          ^ t[3][bytes[i + 4]] ^ t[2][bytes[i + 5]] ^ t[1][bytes[i + 6]] ^ t[0][bytes[i + 7]];
+    }
+    for (; i < size; i++) {
+        c = (c >> 8) ^ t[0][(c ^ bytes[i]) & 0xFF];
+    }
+    crc = c;
+}
+
+uint32_t Checksum::value() const {
+    return ~crc;
+}
+
+uint32_t fileChecksum(const string& name) {
+    ifstream stream;
+    openForReading(stream, name);
+    vector<char> buffer(kReadSize);
+    Checksum checksum;
+    while (size_t size = readBlock(stream, buffer)) {
+        checksum.update(&buffer[0], size);
+    }
+    return checksum.value();
+}
@@ -0,0 +1,83 @@
+/**
+ * File: verify.h
+ * --------------
+ * Defines the checks used to confirm that a round trip gave back what went
+ * in: an exact count of the bits that differ between two buffers or two
+ * files, and a CRC-32 that can be built up a piece at a time, for when the
+ * two sides are not both at hand.  Neither depends on anything
+ * Huffman-specific.
+ */
+
+#ifndef _verify_
+#define _verify_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/*
+ * Function: countDifferingBits
+ * usage: long errors = countDifferingBits(one, two, size);
+ * -------------------------------------------------------
+ * Returns the number of bits that differ between the size bytes at one
+ * and the size bytes at two.
+ */
+long countDifferingBits(const char *one, const char *two, size_t size);
+
+/*
+ * Function: countDifferingBits
+ * usage: long errors = countDifferingBits(fileOne, fileTwo);
+ * ---------------------------------------------------------
+ * Returns the number of bits that differ between the named files.  Every
+ * bit of the longer file past the end of the shorter one counts as a
+ * difference.  The files are read a large block at a time, so neither has
+ * to fit in memory.  Raises an error if either cannot be opened.
+ */
+long countDifferingBits(const std::string& fileOne, const std::string& fileTwo);
+
+/*
+ * Class: Checksum
+ * ---------------
+ * A CRC-32, the same one zlib and gzip use, over everything passed to
+ * update so far.
+ */
+class Checksum {
+public:
+    /*
+     * Constructor: Checksum()
+     * usage: Checksum checksum;
+     * --------------------------------
+     * Starts the checksum of an empty stream.
+     */
+    Checksum();
+
+    /*
+     * Method: update
+     * usage: checksum.update(data, size);
+     * --------------------------------
+     * Adds the size bytes at data to the end of the stream.
+     */
+    void update(const char *data, size_t size);
+
+    /*
+     * Method: value
+     * usage: uint32_t crc = checksum.value();
+     * --------------------------------
+     * Returns the CRC-32 of the stream so far.
+     */
+    uint32_t value() const;
+
+private:
+    uint32_t crc;       /* kept inverted, as the algorithm runs */
+};
+
+/*
+ * Function: fileChecksum
+ * usage: uint32_t crc = fileChecksum(name);
+ * -----------------------------------------
+ * Returns the CRC-32 of the named file, read a block at a time.  Raises
+ * an error if the file cannot be opened.
+ */
+uint32_t fileChecksum(const std::string& name);
+
+#endif
@@ -9,6 +9,7 @@ HEADERS = $$PWD/*.h
 HEADERS += $$PWD/StanfordCPPLib/*.h
 
 QMAKE_CXXFLAGS += -std=c++11
+unix:LIBS += -lpthread
 
 INCLUDEPATH += $$PWD/StanfordCPPLib/
 
@@ -0,0 +1,368 @@
+/**
+ * File: life-benchmark.cpp
+ * ------------------------
+ * Implementation of the Life benchmarks.  Random boards come from
+ * mt19937_64 with a fixed seed, so runs can be compared with each other.
+ */
+
+#include <algorithm> // for max, min
+#include <chrono>    // for steady_clock
+#include <fstream>   // for ifstream
+#include <iostream>  // for cout
+#include <random>    // for mt19937_64
+#include <thread>    // for thread::hardware_concurrency
+using namespace std;
+#include "error.h"   // for error
+#include "strlib.h"  // for integerToString
+
+#include "life-benchmark.h"
+#include "life-bitboard.h"
+#include "life-grid.h"
+#include "life-hashlife.h"
+#include "life-tiled.h"
+
+static const int kCheckRows = 70;            /* not a multiple of 64, to exercise the edges */
+static const int kCheckCols = 150;
+static const int kCheckGenerations = 300;
+static const int kBlinkerSide = 20;
+static const int kBlinkerGenerations = 10;
+static const int kMinSide = 256;
+static const int kMinGridSide = 32;
+static const double kMinSeconds = 0.25;      /* each Grid board is stepped for at least this long */
+static const int kHashCheckMargin = 160;     /* room for a c/2 spaceship to run the whole check */
+static const int kHashCheckGenerations = 300;
+static const int kHashLogStride = 4;
+static const size_t kSmallHashMemory = size_t(256) << 10;
+static const int kTiledCheckRows = 700;      /* neither a multiple of a tile */
+static const int kTiledCheckCols = 1000;
+static const int kTiledCheckSoup = 300;      /* only this corner starts alive, so far tiles are skipped */
+static const int kTiledCheckThreads = 4;
+static const int kSparseReports = 10;
+
+/*
+ * Function: randomGrid
+ * --------------------
+ * Fills grid with newborn cells, each alive with probability one half.
+ */
+static void randomGrid(Grid<int>& grid, mt19937_64& random) {
+    for (int i = 0; i < grid.numRows(); i++) {
+        for (int j = 0; j < grid.numCols(); j++) {
+            grid[i][j] = random() & 1;
+        }
+    }
+}
+
+/*
+ * Function: checkBitBoard
+ * -----------------------
+ * Steps both engines from the same random start and compares every cell's
+ * age after each generation.
+ */
+static void checkBitBoard() {
+    mt19937_64 random(1);
+    Grid<int> start(kCheckRows, kCheckCols);
+    randomGrid(start, random);
+    GridBoard reference;
+    reference.load(start);
+    BitBoard board;
+    board.load(start);
+    for (int generation = 1; generation <= kCheckGenerations; generation++) {
+        reference.step();
+        board.step();
+        for (int i = 0; i < kCheckRows; i++) {
+            for (int j = 0; j < kCheckCols; j++) {
+                if (board.ageAt(i, j) != reference.present().get(i, j)) {
+                    error("BitBoard differs from the Grid engine at (" + integerToString(i) + ", "
+                          + integerToString(j) + ") in generation " + integerToString(generation) + ".");
+                }
+            }
+        }
+    }
+    cout << "BitBoard matches the Grid engine for " << kCheckGenerations << " generations." << endl;
+}
+
+/*
+ * Function: checkBlinker
+ * ----------------------
+ * Runs a lone blinker on a board without ages.  Its block settles after two
+ * generations and is no longer computed, yet the blinker keeps flipping,
+ * so step must keep reporting a change.
+ */
+static void checkBlinker() {
+    BitBoard board(kBlinkerSide, kBlinkerSide, false);
+    for (int j = 4; j <= 6; j++) {
+        board.setAlive(5, j, true);
+    }
+    for (int generation = 1; generation <= kBlinkerGenerations; generation++) {
+        if (!board.step()) {
+            error("BitBoard says a blinker stopped in generation " + integerToString(generation) + ".");
+        }
+        if (board.isAlive(4, 5) != (generation % 2 == 1)) {
+            error("BitBoard's blinker is wrong in generation " + integerToString(generation) + ".");
+        }
+    }
+    if (board.activeBlocks() != 0) error("BitBoard is still computing a settled blinker.");
+    cout << "BitBoard keeps a settled blinker going." << endl;
+}
+
+void benchmarkBitBoard(int maxSide, int generations) {
+    checkBitBoard();
+    checkBlinker();
+    mt19937_64 random(1);
+    for (long side = kMinSide; side <= maxSide; side *= 2) {
+        BitBoard board(side, side, false);
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                if (random() & 1) board.setAlive(i, j, true);
+            }
+        }
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int generation = 0; generation < generations; generation++) {
+            board.step();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << side << " x " << side << ": " << seconds / generations * 1e3 << " ms per generation, "
+             << side * side * generations / seconds / 1e9 << " billion cells per second, "
+             << board.population() << " alive" << endl;
+    }
+}
+
+/*
+ * Each size is stepped until kMinSeconds have passed, so the small boards
+ * are timed over many generations.  The first size's time per cell is the
+ * baseline the others are divided by.
+ */
+void benchmarkGridBoard(int maxSide) {
+    mt19937_64 random(1);
+    double baseline = 0;
+    for (int side = kMinGridSide; side <= maxSide; side *= 2) {
+        Grid<int> start(side, side);
+        randomGrid(start, random);
+        GridBoard board;
+        board.load(start);
+        int generations = 0;
+        double seconds = 0;
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        do {
+            board.step();
+            generations++;
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        } while (seconds < kMinSeconds);
+        double perCell = seconds / generations / (double(side) * side);
+        if (baseline == 0) baseline = perCell;
+        cout << side << " x " << side << ": " << seconds / generations * 1e3 << " ms per generation, "
+             << perCell * 1e9 << " ns per cell (" << perCell / baseline << " times the "
+             << kMinGridSide << " x " << kMinGridSide << " cost)" << endl;
+    }
+}
+
+/*
+ * Function: readPattern
+ * ---------------------
+ * Reads a pattern file: comment lines start with '#', then come the number
+ * of rows and of columns, and then a line per row with X for a live cell.
+ */
+static void readPattern(const string& filename, Grid<int>& grid) {
+    ifstream file(filename.c_str());
+    if (!file) error("Cannot open " + filename + ".");
+    string line;
+    int lineNumber = 0;
+    int numRows = 0;
+    while (getline(file, line)) {
+        if (!line.empty() && line[0] == '#') continue;
+        lineNumber++;
+        if (lineNumber == 1) {
+            numRows = stringToInteger(line);
+        } else if (lineNumber == 2) {
+            grid.resize(numRows, stringToInteger(line));
+        } else if (lineNumber - 3 < numRows) {
+            for (int j = 0; j < grid.numCols() && j < int(line.size()); j++) {
+                grid[lineNumber - 3][j] = line[j] == 'X' ? 1 : 0;
+            }
+        }
+    }
+    if (lineNumber < 2) error(filename + " is not a pattern file.");
+}
+
+/*
+ * Function: checkHashLife
+ * -----------------------
+ * Steps BitBoard a generation at a time next to HashLife jumping 2^0, and
+ * compares every cell of the board after each.  A second HashLife then
+ * covers all the generations with a single advance.
+ */
+static void checkHashLife(const Grid<int>& pattern) {
+    Grid<int> start(pattern.numRows() + 2 * kHashCheckMargin, pattern.numCols() + 2 * kHashCheckMargin);
+    for (int i = 0; i < pattern.numRows(); i++) {
+        for (int j = 0; j < pattern.numCols(); j++) {
+            start[i + kHashCheckMargin][j + kHashCheckMargin] = pattern.get(i, j);
+        }
+    }
+    BitBoard board(start.numRows(), start.numCols(), false);
+    board.load(start);
+    HashLife single;
+    single.load(start);
+    HashLife whole;
+    whole.load(start);
+    whole.advance(kHashCheckGenerations);
+    for (int generation = 1; generation <= kHashCheckGenerations; generation++) {
+        board.step();
+        single.jump(0);
+        for (int i = 0; i < start.numRows(); i++) {
+            for (int j = 0; j < start.numCols(); j++) {
+                bool alive = board.isAlive(i, j);
+                if (single.isAlive(i, j) != alive
+                        || (generation == kHashCheckGenerations && whole.isAlive(i, j) != alive)) {
+                    error("HashLife differs from BitBoard at (" + integerToString(i) + ", "
+                          + integerToString(j) + ") in generation " + integerToString(generation) + ".");
+                }
+            }
+        }
+    }
+    if (single.population() != uint64_t(board.population())) error("HashLife population is wrong.");
+    cout << "HashLife matches BitBoard for " << kHashCheckGenerations << " generations." << endl;
+}
+
+/*
+ * Function: printStatistics
+ * -------------------------
+ * Prints the counters of a HashLife on one line.
+ */
+static void printStatistics(const HashLife::Statistics& stats) {
+    uint64_t lookups = stats.cacheHits + stats.cacheMisses;
+    cout << "  " << stats.nodes << " nodes of " << stats.maxNodes << ", "
+         << (stats.memoryBytes >> 10) << " KiB, hit rate "
+         << (lookups == 0 ? 0 : 100.0 * stats.cacheHits / lookups) << "%, "
+         << stats.resultsDiscarded << " results discarded, " << stats.resultsEvicted << " evicted, "
+         << stats.collections << " collections freeing " << stats.nodesFreed << " nodes" << endl;
+}
+
+void benchmarkHashLife(const string& filename, int maxLog2Generations) {
+    Grid<int> pattern;
+    readPattern(filename, pattern);
+    checkHashLife(pattern);
+    uint64_t largestPopulation = 0;
+    for (int k = 0; k <= maxLog2Generations; k += kHashLogStride) {
+        HashLife engine;
+        engine.load(pattern);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        engine.jump(k);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "2^" << k << " generations: " << seconds * 1e3 << " ms, population "
+             << engine.population() << endl;
+        printStatistics(engine.statistics());
+        largestPopulation = engine.population();
+    }
+    int largest = maxLog2Generations - maxLog2Generations % kHashLogStride;
+    HashLife small(kSmallHashMemory);
+    small.load(pattern);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    small.jump(largest);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "2^" << largest << " generations in " << (kSmallHashMemory >> 10) << " KiB: "
+         << seconds * 1e3 << " ms, population " << small.population()
+         << (small.population() == largestPopulation ? " (same)" : " (DIFFERENT)") << endl;
+    printStatistics(small.statistics());
+}
+
+/*
+ * Function: checkTiledBoard
+ * -------------------------
+ * Steps TiledBoard on several threads next to BitBoard from a random soup
+ * in one corner, comparing every cell after each generation.  Halfway
+ * through, a blinker is set by hand in a tile that has been skipped until
+ * then, which must wake it up.
+ */
+static void checkTiledBoard() {
+    mt19937_64 random(1);
+    BitBoard reference(kTiledCheckRows, kTiledCheckCols, false);
+    TiledBoard board(kTiledCheckRows, kTiledCheckCols, kTiledCheckThreads);
+    for (int i = 0; i < kTiledCheckSoup; i++) {
+        for (int j = 0; j < kTiledCheckSoup; j++) {
+            bool alive = random() & 1;
+            reference.setAlive(i, j, alive);
+            board.setAlive(i, j, alive);
+        }
+    }
+    for (int generation = 1; generation <= kCheckGenerations; generation++) {
+        if (generation == kCheckGenerations / 2) {
+            for (int j = kTiledCheckCols - 3; j < kTiledCheckCols; j++) {
+                reference.setAlive(kTiledCheckRows - 2, j, true);
+                board.setAlive(kTiledCheckRows - 2, j, true);
+            }
+        }
+        reference.step();
+        board.step();
+        for (int i = 0; i < kTiledCheckRows; i++) {
+            for (int j = 0; j < kTiledCheckCols; j++) {
+                if (board.isAlive(i, j) != reference.isAlive(i, j)) {
+                    error("TiledBoard differs from BitBoard at (" + integerToString(i) + ", "
+                          + integerToString(j) + ") in generation " + integerToString(generation) + ".");
+                }
+            }
+        }
+    }
+    cout << "TiledBoard matches BitBoard for " << kCheckGenerations << " generations." << endl;
+}
+
+/*
+ * Every thread count starts from the same soup.  The speedup is over the
+ * one-thread run, and the share of tiles computed shows how much of the
+ * board the skipping saved.
+ */
+void benchmarkTiledBoard(int side, int generations) {
+    checkTiledBoard();
+    int maxThreads = max(int(thread::hardware_concurrency()), 1);
+    double baseline = 0;
+    for (int numThreads = 1; ; numThreads = min(numThreads * 2, maxThreads)) {
+        mt19937_64 random(1);
+        TiledBoard board(side, side, numThreads);
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                if (random() & 1) board.setAlive(i, j, true);
+            }
+        }
+        long tiles = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int generation = 0; generation < generations; generation++) {
+            board.step();
+            tiles += board.tilesComputed();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (baseline == 0) baseline = seconds;
+        cout << numThreads << (numThreads == 1 ? " thread: " : " threads: ")
+             << seconds / generations * 1e3 << " ms per generation, "
+             << double(side) * side * generations / seconds / 1e9 << " billion cells per second, speedup "
+             << baseline / seconds << ", " << 100.0 * tiles / (double(board.numTiles()) * generations)
+             << "% of tiles computed, " << board.population() << " alive" << endl;
+        if (numThreads == maxThreads) break;
+    }
+}
+
+/*
+ * Each report covers the generations since the last one, so the time per
+ * generation can be set beside the number of blocks computed on average.
+ */
+void benchmarkSparseBitBoard(int side, int generations) {
+    mt19937_64 random(1);
+    BitBoard board(side, side, false);
+    for (int i = 0; i < side; i++) {
+        for (int j = 0; j < side; j++) {
+            if (random() & 1) board.setAlive(i, j, true);
+        }
+    }
+    int stretch = max(generations / kSparseReports, 1);
+    for (int generation = 0; generation < generations; ) {
+        long blocks = 0;
+        int steps = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (; steps < stretch && generation < generations; steps++, generation++) {
+            board.step();
+            blocks += board.activeBlocks();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "to generation " << generation << ": " << double(blocks) / steps << " of "
+             << board.numBlocks() << " blocks active, " << seconds / steps * 1e3 << " ms per generation, "
+             << board.population() << " alive" << endl;
+    }
+}
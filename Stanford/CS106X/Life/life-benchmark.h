@@ -0,0 +1,76 @@
+/**
+ * File: life-benchmark.h
+ * ----------------------
+ * Timing and checking routines for the Life engines.  None of them is
+ * called by the simulation; main has commented-out calls to each, and they
+ * print their results to the console.
+ */
+
+#ifndef _life_benchmark_h_
+#define _life_benchmark_h_
+
+#include <string>    // for std::string
+
+/*
+ * Function: benchmarkBitBoard
+ * usage: benchmarkBitBoard(16384, 10);
+ * --------------------------------
+ * First runs BitBoard and the Grid<int> engine side by side on a small
+ * random board, raising an error if their cells or ages ever differ, and
+ * checks that a blinker BitBoard no longer computes still counts as
+ * changing.  Then times BitBoard, without ages, on random boards with half
+ * their cells alive, from 256 by 256 up to maxSide by maxSide cells,
+ * printing the time per generation averaged over the given number of
+ * generations.
+ */
+void benchmarkBitBoard(int maxSide, int generations);
+
+/*
+ * Function: benchmarkGridBoard
+ * usage: benchmarkGridBoard(1024);
+ * --------------------------------
+ * Times GridBoard on random boards from 32 by 32 up to maxSide by maxSide
+ * cells, doubling the side each time, and prints the time per generation
+ * and per cell.  The time per cell should stay flat as the board grows:
+ * a generation costs the same for every cell, however many there are.
+ */
+void benchmarkGridBoard(int maxSide);
+
+/*
+ * Function: benchmarkHashLife
+ * usage: benchmarkHashLife("Glider Gun", 32);
+ * --------------------------------
+ * Reads a pattern in the format of the files in resources/files and checks
+ * HashLife against BitBoard on it for a few hundred generations, on a board
+ * with room enough that the edges do not matter.  Then jumps a fresh engine
+ * ahead by 2^k generations for k from 0 to maxLog2Generations in steps of
+ * 4, printing the time, the population, and the engine's statistics, and
+ * finally repeats the largest jump with a small memory limit, to show the
+ * garbage collector at work.
+ */
+void benchmarkHashLife(const std::string& filename, int maxLog2Generations);
+
+/*
+ * Function: benchmarkTiledBoard
+ * usage: benchmarkTiledBoard(16384, 100);
+ * --------------------------------
+ * First checks TiledBoard against BitBoard on a board partly filled with a
+ * random soup.  Then times it on a side by side board, half of it alive,
+ * for the given number of generations with one thread, two, four, and so
+ * on up to the number of cores, and prints each run's speedup over one
+ * thread.
+ */
+void benchmarkTiledBoard(int side, int generations);
+
+/*
+ * Function: benchmarkSparseBitBoard
+ * usage: benchmarkSparseBitBoard(2048, 5000);
+ * --------------------------------
+ * Runs BitBoard on a side by side random soup for the given number of
+ * generations, printing ten times along the way how many of its blocks
+ * were active per generation and what a generation cost.  As the soup
+ * settles, both should fall together.
+ */
+void benchmarkSparseBitBoard(int side, int generations);
+
+#endif
@@ -0,0 +1,306 @@
+/**
+ * File: life-bitboard.cpp
+ * -----------------------
+ * Implementation of BitBoard.  Bit i of word w in a row holds column
+ * 64 * w + i.  A generation is computed a word at a time: the eight
+ * neighbors of all 64 cells are lined up as eight words by shifting the
+ * rows above, below, and through the cell one column each way, and then
+ * added bit by bit with full and half adders, so that only the count's
+ * low bit and whether its upper part is exactly one are ever formed.
+ *
+ * The board is also cut into blocks one word wide and kBlockRows rows
+ * high, and a step computes only the blocks that have not settled and
+ * their neighbors.  With ages tracked, a block has settled when nothing in
+ * it changed in the last step, ages included: every age the display shows
+ * must be brought up to date.  Then a block that is skipped comes out the
+ * same as it is, and it holds the same cells in both buffers.  Without
+ * ages, a block has settled when the step brought back the cells it had
+ * two generations ago, which is also true of blinkers and other period-2
+ * oscillators, the commonest debris of a soup.  A skipped block's next
+ * generation is then the one before this, which is just what is left in
+ * the back buffer.  setAlive breaks that for its block, which is marked
+ * kSetByHand and so stays unsettled through the next step as well.  A
+ * settled block may still be changing, flipping between its two states,
+ * so each block also remembers whether its cells moved when it was last
+ * computed, and the board has changed while any block still moves.
+ */
+
+#include <algorithm> // for min, max, sort
+using namespace std;
+#include "error.h"   // for error
+#include "strlib.h"  // for integerToString
+
+#include "life-constants.h"  // for kMaxAge
+#include "life-bitboard.h"
+
+static const int kWordBits = 64;
+static const int kBlockRows = 64;
+
+/* The marks a block can carry in blockChanged. */
+static const uint8_t kSettled = 0;
+static const uint8_t kChanged = 1;
+static const uint8_t kSetByHand = 2;
+
+BitBoard::BitBoard() {
+    resize(0, 0);
+}
+
+BitBoard::BitBoard(int numRows, int numCols, bool trackAges) {
+    resize(numRows, numCols, trackAges);
+}
+
+void BitBoard::resize(int numRows, int numCols, bool trackAges) {
+    if (numRows < 0 || numCols < 0) error("BitBoard::resize given a negative size.");
+    rows = numRows;
+    cols = numCols;
+    tracksAges = trackAges;
+    wordsPerRow = (cols + kWordBits - 1) / kWordBits;
+    int lastBits = cols % kWordBits;
+    lastWordMask = lastBits == 0 ? ~uint64_t(0) : (uint64_t(1) << lastBits) - 1;
+    size_t words = size_t(rows) * wordsPerRow;
+    cells.assign(words + 2 * wordsPerRow, 0);
+    next.assign(words + 2 * wordsPerRow, 0);
+    aging.assign(trackAges ? words : 0, 0);
+    ages.assign(trackAges ? size_t(rows) * cols : 0, 0);
+    changes.clear();
+    runs.clear();
+    blockRows = (rows + kBlockRows - 1) / kBlockRows;
+    blockChanged.assign(size_t(blockRows) * wordsPerRow, 0);
+    queued.assign(blockChanged.size(), 0);
+    changedBlocks.clear();
+    active.clear();
+    moving.assign(blockChanged.size(), 0);
+    movingBlocks = 0;
+}
+
+int BitBoard::numRows() const {
+    return rows;
+}
+
+int BitBoard::numCols() const {
+    return cols;
+}
+
+void BitBoard::checkLocation(int row, int column) const {
+    if (row < 0 || row >= rows || column < 0 || column >= cols) {
+        error("BitBoard location (" + integerToString(row) + ", " + integerToString(column)
+              + ") is outside the board.");
+    }
+}
+
+bool BitBoard::isAlive(int row, int column) const {
+    checkLocation(row, column);
+    return (cells[size_t(row + 1) * wordsPerRow + column / kWordBits] >> (column % kWordBits)) & 1;
+}
+
+void BitBoard::setAlive(int row, int column, bool alive) {
+    checkLocation(row, column);
+    uint64_t bit = uint64_t(1) << (column % kWordBits);
+    size_t word = size_t(row) * wordsPerRow + column / kWordBits;
+    if (alive) {
+        cells[word + wordsPerRow] |= bit;
+    } else {
+        cells[word + wordsPerRow] &= ~bit;
+    }
+    int block = row / kBlockRows * wordsPerRow + column / kWordBits;
+    if (blockChanged[block] == kSettled) changedBlocks.push_back(block);
+    blockChanged[block] = kSetByHand;
+    if (!tracksAges) return;
+    ages[size_t(row) * cols + column] = alive ? 1 : 0;
+    if (alive && kMaxAge > 1) {
+        aging[word] |= bit;
+    } else {
+        aging[word] &= ~bit;
+    }
+}
+
+int BitBoard::ageAt(int row, int column) const {
+    checkLocation(row, column);
+    if (!tracksAges) error("BitBoard::ageAt called on a board that does not track ages.");
+    return ages[size_t(row) * cols + column];
+}
+
+void BitBoard::load(const Grid<int>& grid) {
+    resize(grid.numRows(), grid.numCols(), tracksAges);
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < cols; column++) {
+            if (grid.get(row, column) == 0) continue;
+            setAlive(row, column, true);
+            if (!tracksAges) continue;
+            int age = min(grid.get(row, column), kMaxAge);
+            ages[size_t(row) * cols + column] = age;
+            if (age == kMaxAge) {
+                aging[size_t(row) * wordsPerRow + column / kWordBits] &= ~(uint64_t(1) << (column % kWordBits));
+            }
+        }
+    }
+}
+
+long BitBoard::population() const {
+    long count = 0;
+    for (size_t i = 0; i < cells.size(); i++) {
+        count += __builtin_popcountll(cells[i]);
+    }
+    return count;
+}
+
+/*
+ * Method: step
+ * ------------
+ * Gathers the blocks that changed last time, with their neighbors, into
+ * the list of blocks to compute, in order, and computes only those.  The
+ * list is built from the changed blocks alone, so a board where little
+ * happens costs little however big it is.
+ */
+bool BitBoard::step() {
+    active.clear();
+    for (size_t i = 0; i < changedBlocks.size(); i++) {
+        int blockRow = changedBlocks[i] / wordsPerRow;
+        int blockCol = changedBlocks[i] % wordsPerRow;
+        for (int r = max(blockRow - 1, 0); r <= min(blockRow + 1, blockRows - 1); r++) {
+            for (int c = max(blockCol - 1, 0); c <= min(blockCol + 1, wordsPerRow - 1); c++) {
+                int block = r * wordsPerRow + c;
+                if (queued[block]) continue;
+                queued[block] = 1;
+                active.push_back(block);
+            }
+        }
+        uint8_t &mark = blockChanged[changedBlocks[i]];
+        mark = mark == kSetByHand ? kChanged : kSettled;
+    }
+    sort(active.begin(), active.end());
+    changedBlocks.clear();
+    changes.clear();
+    bool agesChanged = false;
+    size_t begin = 0;
+    while (begin < active.size()) {
+        size_t end = begin + 1;
+        while (end < active.size() && active[end] / wordsPerRow == active[begin] / wordsPerRow) end++;
+        if (stepBand(begin, end)) agesChanged = true;
+        begin = end;
+    }
+    cells.swap(next);
+    return tracksAges ? agesChanged : movingBlocks != 0;
+}
+
+/*
+ * Method: stepBand
+ * ----------------
+ * Computes the next generation of the active blocks from begin up to end,
+ * which all lie in the same band of kBlockRows rows, and marks those that
+ * have not settled.  With ages tracked it returns whether any age changed;
+ * without them it brings moving and movingBlocks up to date and returns
+ * false.  Blocks side by side are gathered into runs, and the band is
+ * worked through a row at a time, each run with a window of three words
+ * from each of the three rows, so every word is loaded once per row that
+ * reads it.  The dead rows
+ * above and below the board stand in for the missing neighbors at the top
+ * and bottom, and zeros at the two ends of each row for those at the
+ * sides.
+ */
+bool BitBoard::stepBand(size_t begin, size_t end) {
+    int band = active[begin] / wordsPerRow;
+    uint8_t *bandChanged = &blockChanged[size_t(band) * wordsPerRow];
+    uint8_t *bandMoving = &moving[size_t(band) * wordsPerRow];
+    runs.clear();
+    for (size_t i = begin; i < end; i++) {
+        int word = active[i] % wordsPerRow;
+        if (!runs.empty() && runs.back().second == word) {
+            runs.back().second++;
+        } else {
+            runs.push_back(make_pair(word, word + 1));
+        }
+        queued[active[i]] = 0;
+        movingBlocks -= moving[active[i]];
+        moving[active[i]] = 0;
+    }
+    int firstRow = band * kBlockRows;
+    int endRow = min(firstRow + kBlockRows, rows);
+    /* Stores to bandChanged and bandMoving may alias any member, so those read in the loop are copied. */
+    int width = wordsPerRow;
+    uint64_t edgeMask = lastWordMask;
+    bool aged = tracksAges;
+    bool agesChanged = false;
+    for (int row = firstRow; row < endRow; row++) {
+        const uint64_t *above = &cells[size_t(row) * width];
+        const uint64_t *middle = above + width;
+        const uint64_t *below = middle + width;
+        uint64_t *out = &next[size_t(row + 1) * width];
+        for (size_t k = 0; k < runs.size(); k++) {
+            int word = runs[k].first;
+            int endWord = runs[k].second;
+            uint64_t aboveLeft = word == 0 ? 0 : above[word - 1];
+            uint64_t middleLeft = word == 0 ? 0 : middle[word - 1];
+            uint64_t belowLeft = word == 0 ? 0 : below[word - 1];
+            for (; word < endWord; word++) {
+                bool last = word + 1 == width;
+                uint64_t aboveRight = last ? 0 : above[word + 1];
+                uint64_t middleRight = last ? 0 : middle[word + 1];
+                uint64_t belowRight = last ? 0 : below[word + 1];
+                uint64_t after = nextWord(aboveLeft, above[word], aboveRight,
+                                          middleLeft, middle[word], middleRight,
+                                          belowLeft, below[word], belowRight);
+                if (last) after &= edgeMask;
+                if (aged) {
+                    if (updateAges(row, word, middle[word], after)) {
+                        bandChanged[word] = kChanged;
+                        agesChanged = true;
+                    }
+                } else {
+                    bandChanged[word] |= after != out[word];
+                    bandMoving[word] |= after != middle[word];
+                }
+                out[word] = after;
+                aboveLeft = above[word];
+                middleLeft = middle[word];
+                belowLeft = below[word];
+            }
+        }
+    }
+    for (size_t i = begin; i < end; i++) {
+        if (blockChanged[active[i]] != kSettled) changedBlocks.push_back(active[i]);
+        movingBlocks += moving[active[i]];
+    }
+    return agesChanged;
+}
+
+/*
+ * Method: updateAges
+ * ------------------
+ * Brings the ages of one word's cells up to date, given the cells before and
+ * after the step, and returns whether any age changed.  Only cells that were
+ * born, died, or are still young enough to grow older are visited.
+ */
+bool BitBoard::updateAges(int row, int word, uint64_t before, uint64_t after) {
+    uint64_t &young = aging[size_t(row) * wordsPerRow + word];
+    uint64_t visit = (before ^ after) | (after & young);
+    if (visit == 0) return false;
+    int firstColumn = word * kWordBits;
+    uint8_t *rowAges = &ages[size_t(row) * cols];
+    while (visit != 0) {
+        int bit = __builtin_ctzll(visit);
+        visit &= visit - 1;
+        uint64_t mask = uint64_t(1) << bit;
+        uint8_t &age = rowAges[firstColumn + bit];
+        age = (after & mask) ? min(age + 1, kMaxAge) : 0;
+        if (age != 0 && age < kMaxAge) {
+            young |= mask;
+        } else {
+            young &= ~mask;
+        }
+        changes.push_back(make_pair(row, firstColumn + bit));
+    }
+    return true;
+}
+
+const vector<pair<int, int> >& BitBoard::changedCells() const {
+    return changes;
+}
+
+int BitBoard::numBlocks() const {
+    return blockChanged.size();
+}
+
+int BitBoard::activeBlocks() const {
+    return active.size();
+}
@@ -0,0 +1,160 @@
+/**
+ * File: life-bitboard.h
+ * ---------------------
+ * Defines a Game of Life board that packs 64 cells into each machine word
+ * and computes the next generation of a whole word at once.  The rules and
+ * the edges are the same as in the Grid<int> simulation: cells beyond the
+ * edge of the board are dead and stay dead.  Only the parts of the board
+ * where something is happening are computed, so once most of a pattern
+ * has settled, a generation costs little however big the board is.
+ */
+
+#ifndef _life_bitboard_h_
+#define _life_bitboard_h_
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint8_t, uint64_t
+#include <utility>   // for std::pair
+#include <vector>    // for std::vector
+#include "grid.h"    // for Grid
+
+class BitBoard {
+public:
+
+    /**
+     * Creates an empty board; call resize before using it.
+     */
+    BitBoard();
+
+    /**
+     * Creates a board of the given size with every cell dead.  If trackAges
+     * is false, no ages are kept, which saves a byte per cell on boards too
+     * big for the display anyway.
+     */
+    BitBoard(int numRows, int numCols, bool trackAges = true);
+
+    /**
+     * Changes the size of the board and kills every cell.
+     */
+    void resize(int numRows, int numCols, bool trackAges = true);
+
+    int numRows() const;
+    int numCols() const;
+
+    /**
+     * Returns whether the cell at row and column is alive.  Raises an error if
+     * the location is not on the board.
+     */
+    bool isAlive(int row, int column) const;
+
+    /**
+     * Brings the cell at row and column to life with age 1, or kills it.
+     */
+    void setAlive(int row, int column, bool alive);
+
+    /**
+     * Returns the age of the cell at row and column, 0 for a dead cell, as the
+     * Grid<int> simulation counts it: 1 when born, one more each generation
+     * it survives, up to kMaxAge.  Raises an error if ages are not tracked.
+     */
+    int ageAt(int row, int column) const;
+
+    /**
+     * Resizes the board to match grid and copies it, treating every nonzero
+     * value as a live cell of that age.
+     */
+    void load(const Grid<int>& grid);
+
+    /**
+     * Returns the number of live cells.
+     */
+    long population() const;
+
+    /**
+     * Advances the board by one generation and returns whether anything
+     * changed: any cell, or any age when ages are tracked.  A false return
+     * means every later generation will be the same as this one.
+     */
+    bool step();
+
+    /**
+     * Returns the row and column of every cell whose age changed in the last
+     * step, block by block.  These are the only cells the display has to
+     * redraw.  Empty when ages are not tracked.
+     */
+    const std::vector<std::pair<int, int> >& changedCells() const;
+
+    /**
+     * Returns the number of blocks the board is cut into, and how many of
+     * them the last step computed: those that had not settled in the step
+     * before, and their neighbors.  The others cost nothing.
+     */
+    int numBlocks() const;
+    int activeBlocks() const;
+
+private:
+    int rows;
+    int cols;
+    int wordsPerRow;
+    bool tracksAges;
+    uint64_t lastWordMask;               /* the bits of the last word of a row that are on the board */
+    std::vector<uint64_t> cells;         /* a dead row above and below the board, then wordsPerRow per row */
+    std::vector<uint64_t> next;          /* the generation being computed, laid out the same */
+    std::vector<uint64_t> aging;         /* live cells younger than kMaxAge, without the dead rows */
+    std::vector<uint8_t> ages;           /* one per cell, row by row; empty when not tracked */
+    std::vector<std::pair<int, int> > changes;
+    int blockRows;                       /* blocks down the board; there are wordsPerRow across */
+    std::vector<uint8_t> blockChanged;   /* per block: kSettled, kChanged, or kSetByHand */
+    std::vector<int> changedBlocks;      /* the blocks marked in blockChanged */
+    std::vector<int> active;             /* the blocks the last step computed, in order */
+    std::vector<uint8_t> queued;         /* per block: already in active, while it is built */
+    std::vector<std::pair<int, int> > runs;  /* the words of a band's blocks that lie side by side */
+    std::vector<uint8_t> moving;         /* per block, without ages: its cells changed when last computed */
+    int movingBlocks;                    /* the blocks marked in moving */
+
+    void checkLocation(int row, int column) const;
+    bool stepBand(size_t begin, size_t end);
+    bool updateAges(int row, int word, uint64_t before, uint64_t after);
+};
+
+/*
+ * Function: nextWord
+ * ------------------
+ * Returns the next generation of the 64 cells in middle, given the words
+ * on either side of it and the three words above and below.  Adding the
+ * three cells above gives a sum bit and a carry worth two, and likewise
+ * below; the two beside give a half adder's sum and carry.  The three sum
+ * bits add to the count's low bit and one more carry worth two.  A cell
+ * lives on exactly when its count is 3, or 2 and it is already alive: the
+ * twos must add to exactly one, and the low bit must be set unless the
+ * cell is alive.  Every engine that packs cells this way steps with it.
+ */
+inline uint64_t nextWord(uint64_t aboveLeft, uint64_t above, uint64_t aboveRight,
+                        uint64_t left, uint64_t middle, uint64_t right,
+                        uint64_t belowLeft, uint64_t below, uint64_t belowRight) {
+    uint64_t a0 = (above << 1) | (aboveLeft >> 63);
+    uint64_t a2 = (above >> 1) | (aboveRight << 63);
+    uint64_t m0 = (middle << 1) | (left >> 63);
+    uint64_t m2 = (middle >> 1) | (right << 63);
+    uint64_t b0 = (below << 1) | (belowLeft >> 63);
+    uint64_t b2 = (below >> 1) | (belowRight << 63);
+
+    uint64_t aboveSum = a0 ^ above ^ a2;
+    uint64_t aboveCarry = (a0 & above) | (a2 & (a0 ^ above));
+    uint64_t belowSum = b0 ^ below ^ b2;
+    uint64_t belowCarry = (b0 & below) | (b2 & (b0 ^ below));
+    uint64_t sideSum = m0 ^ m2;
+    uint64_t sideCarry = m0 & m2;
+
+    uint64_t ones = aboveSum ^ belowSum ^ sideSum;
+    uint64_t onesCarry = (aboveSum & belowSum) | (sideSum & (aboveSum ^ belowSum));
+
+    /* Exactly one of the four carries, each worth two, is set. */
+    uint64_t pairOne = aboveCarry ^ belowCarry;
+    uint64_t pairTwo = sideCarry ^ onesCarry;
+    uint64_t atLeastTwo = (aboveCarry & belowCarry) | (sideCarry & onesCarry) | (pairOne & pairTwo);
+    uint64_t exactlyOne = (pairOne ^ pairTwo) & ~atLeastTwo;
+    return exactlyOne & (ones | middle);
+}
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * File: life-grid.cpp
+ * -------------------
+ * Implements the Grid<int> Game of Life engine.
+ */
+
+#include "life-constants.h"  // for kMaxAge
+#include "life-grid.h"
+
+/*
+ * function: updateFutureGrid(futureGrid, presentGrid)
+ * usage: bool changed = updateFutureGrid(futureGrid, presentGrid);
+ * -------------------
+ * This function loops through every cell in the grid, and updates the cell in futureGrid
+ * by calling updateCell().  Both grids are passed by reference, so a generation copies
+ * nothing and its cost is a fixed amount per cell.
+ */
+bool updateFutureGrid(Grid<int>& futureGrid, const Grid<int>& presentGrid){
+    bool changed = false;
+    for (int i=0; i<presentGrid.numRows(); i++){
+        for (int j = 0; j<presentGrid.numCols(); j++){
+            updateCell(futureGrid, presentGrid, i, j);
+            if (futureGrid[i][j] != presentGrid.get(i, j)) changed = true;
+        }
+    }
+    return changed;
+}
+
+/*
+ * function: updateCell(futureGrid, presentGrid, i, j)
+ * usage: updateCell(futureGrid, presentGrid, i, j);
+ * -------------------
+ * Update cell checks all cells surrounding presentGrid[i][j].  It counts how many neighboring cells are
+ * living, and updates futureGrid[i][j] based on that count and the rules explained in welcome().
+ */
+void updateCell(Grid<int>& futureGrid, const Grid<int>& presentGrid, int i, int j){
+    int numNeighbors = 0;
+    for (int drow = -1; drow <= 1; drow++) {
+        for (int dcol = -1; dcol <= 1; dcol++) {                /* Loops through all neighbors of the cell. If   */
+            if (presentGrid.inBounds(i+drow, j+dcol)) {         /* a neighbor has value has a cell, increment    */
+                if (dcol == 0 && drow == 0){                    /* the numNeighbor counter.  The counter is not  */
+                    numNeighbors += 0;                          /* incremented for the cell itself. The value of */
+                }else if (presentGrid.get(i+drow, j+dcol) != 0){/* the counter after these loops is the number of*/
+                    numNeighbors += 1;                          /* neighbors.                                    */
+                }
+            }
+        }
+    }
+    int age = presentGrid.get(i, j);                            /* The new age is worked out from the present    */
+    if (numNeighbors == 2){                                     /* one, so futureGrid may hold anything at all.  */
+        if (age > 0 && age < kMaxAge){
+            age += 1;
+        }
+    }else if (numNeighbors == 3){
+        if (age < kMaxAge){
+            age += 1;
+        }
+    } else{
+        age = 0;
+    }
+    futureGrid[i][j] = age;
+}
+
+GridBoard::GridBoard() {
+    current = 0;
+}
+
+void GridBoard::load(const Grid<int>& grid) {
+    buffers[0] = grid;
+    buffers[1].resize(grid.numRows(), grid.numCols());
+    current = 0;
+}
+
+int GridBoard::numRows() const {
+    return buffers[current].numRows();
+}
+
+int GridBoard::numCols() const {
+    return buffers[current].numCols();
+}
+
+const Grid<int>& GridBoard::present() const {
+    return buffers[current];
+}
+
+/*
+ * Method: step
+ * ------------
+ * The back buffer is overwritten completely, so whatever an earlier
+ * generation left in it does not matter, and the buffers trade places by
+ * flipping current rather than by copying.
+ */
+bool GridBoard::step() {
+    bool changed = updateFutureGrid(buffers[1 - current], buffers[current]);
+    current = 1 - current;
+    return changed;
+}
@@ -0,0 +1,63 @@
+/**
+ * File: life-grid.h
+ * -----------------
+ * The original Game of Life engine, which keeps the board in a Grid<int>
+ * of cell ages.  The simulation now runs on BitBoard, and this engine is
+ * kept as the plain statement of the rules that faster engines are checked
+ * against.
+ */
+
+#ifndef _life_grid_h_
+#define _life_grid_h_
+
+#include "grid.h"    // for Grid
+
+/*
+ * Computes the generation after presentGrid in futureGrid, which must be the
+ * same size, and returns whether any cell's age changed.  Nothing is read
+ * from futureGrid, so it can be a buffer left over from any generation.
+ */
+bool updateFutureGrid(Grid<int>& futureGrid, const Grid<int>& presentGrid);
+
+/*
+ * Computes the next state of the cell at row i, column j into futureGrid.
+ */
+void updateCell(Grid<int>& futureGrid, const Grid<int>& presentGrid, int i, int j);
+
+/*
+ * Class: GridBoard
+ * ----------------
+ * A double-buffered board for the Grid engine.  Two grids are allocated when
+ * the board is loaded, and each step computes the back one from the front
+ * one and then swaps their roles, so stepping never allocates or copies a
+ * grid.
+ */
+class GridBoard {
+public:
+    GridBoard();
+
+    /*
+     * Sizes both buffers to match grid and copies grid into the front one.
+     */
+    void load(const Grid<int>& grid);
+
+    int numRows() const;
+    int numCols() const;
+
+    /*
+     * Returns the current generation.  The reference is to one of the two
+     * buffers and shows a later generation after the next call to step.
+     */
+    const Grid<int>& present() const;
+
+    /*
+     * Advances the board a generation and returns whether any age changed.
+     */
+    bool step();
+
+private:
+    Grid<int> buffers[2];
+    int current;                        /* the buffer holding the present generation */
+};
+
+#endif
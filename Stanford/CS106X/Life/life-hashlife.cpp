@@ -0,0 +1,449 @@
+/**
+ * File: life-hashlife.cpp
+ * -----------------------
+ * Implementation of HashLife, after Gosper's algorithm.  The result of a
+ * node of level k is worked out from nine overlapping subsquares of level
+ * k - 1: each of their results is found, the nine results are combined into
+ * four squares of level k - 1 again, and the results of those four make up
+ * the answer.  At full speed both rounds advance time, for 2^(k-2)
+ * generations in all; to jump fewer generations, the first round just takes
+ * the centers of the nine squares without advancing them.
+ *
+ * Nodes live in one array and refer to each other by index, so that the
+ * array can be preallocated to the memory limit and nodes freed by garbage
+ * collection can be reused without moving anything.  Garbage collection can
+ * run in the middle of a step, so every node a step is holding on to, and
+ * that is not a child of another such node, is kept on the protect stack.
+ */
+
+#include <algorithm> // for min, max
+using namespace std;
+#include "error.h"   // for error
+
+#include "life-hashlife.h"
+
+static const uint32_t kNoNode = 0xFFFFFFFF;
+static const uint32_t kDeadCell = 0;
+static const uint32_t kLiveCell = 1;
+static const int kMinRootLevel = 3;          /* the smallest root whose center can be checked */
+static const int kMaxRootLevel = 62;         /* coordinates beyond this overflow int64_t */
+static const size_t kMinBuckets = 1 << 10;
+
+HashLife::HashLife(size_t memoryLimit) {
+    maxNodes = memoryLimit / (sizeof(Node) + sizeof(uint32_t));
+    maxNodes = min(maxNodes, size_t(kNoNode - 1));
+    if (maxNodes < 1024) error("HashLife memory limit is too small.");
+    nodes.reserve(maxNodes);
+    stats.cacheHits = stats.cacheMisses = 0;
+    stats.resultsDiscarded = stats.resultsEvicted = 0;
+    stats.collections = stats.nodesFreed = 0;
+    reset();
+}
+
+/*
+ * Method: reset
+ * -------------
+ * Empties the node table down to the two cells and makes an empty root.
+ */
+void HashLife::reset() {
+    nodes.clear();
+    for (uint32_t cell = kDeadCell; cell <= kLiveCell; cell++) {
+        Node leaf = {{kNoNode, kNoNode, kNoNode, kNoNode}, kNoNode, kNoNode, cell, 0};
+        nodes.push_back(leaf);
+    }
+    liveNodes = nodes.size();
+    freeList = kNoNode;
+    buckets.assign(kMinBuckets, kNoNode);
+    emptyNodes.assign(1, kDeadCell);
+    protect.clear();
+    stepLog = 0;
+    generations = 0;
+    originRow = originColumn = 0;
+    root = emptyNode(kMinRootLevel);
+}
+
+/*
+ * Method: allocate
+ * ----------------
+ * Returns a free node, collecting garbage first if the table is full.  If
+ * keeping the cached results leaves the table nearly full, they are dropped.
+ */
+uint32_t HashLife::allocate() {
+    if (liveNodes >= maxNodes) {
+        collect(true);
+        if (liveNodes > maxNodes / 4 * 3) collect(false);
+        if (liveNodes >= maxNodes) error("HashLife pattern does not fit in its memory limit.");
+    }
+    liveNodes++;
+    if (freeList != kNoNode) {
+        uint32_t node = freeList;
+        freeList = nodes[node].next;
+        return node;
+    }
+    nodes.push_back(Node());
+    return nodes.size() - 1;
+}
+
+static inline size_t hashChildren(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    uint64_t h = nw * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ ne) * 0xC2B2AE3D27D4EB4FULL;
+    h = (h ^ sw) * 0x165667B19E3779F9ULL;
+    h = (h ^ se) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
+void HashLife::insert(uint32_t node) {
+    const uint32_t *c = nodes[node].child;
+    size_t bucket = hashChildren(c[0], c[1], c[2], c[3]) & (buckets.size() - 1);
+    nodes[node].next = buckets[bucket];
+    buckets[bucket] = node;
+}
+
+void HashLife::rehash(size_t numBuckets) {
+    buckets.assign(numBuckets, kNoNode);
+    for (size_t node = kLiveCell + 1; node < nodes.size(); node++) {
+        if (nodes[node].level > 0) insert(node);
+    }
+}
+
+/*
+ * Method: join
+ * ------------
+ * Returns the one node with the given children, making it if it does not
+ * exist yet.  The children must be protected, since making a node may
+ * collect garbage.
+ */
+uint32_t HashLife::join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    size_t hash = hashChildren(nw, ne, sw, se);
+    for (uint32_t node = buckets[hash & (buckets.size() - 1)]; node != kNoNode; node = nodes[node].next) {
+        const uint32_t *c = nodes[node].child;
+        if (c[0] == nw && c[1] == ne && c[2] == sw && c[3] == se) return node;
+    }
+    uint32_t node = allocate();
+    Node& made = nodes[node];
+    made.child[0] = nw;
+    made.child[1] = ne;
+    made.child[2] = sw;
+    made.child[3] = se;
+    made.result = kNoNode;
+    made.level = nodes[nw].level + 1;
+    made.population = nodes[nw].population + nodes[ne].population + nodes[sw].population + nodes[se].population;
+    size_t bucket = hash & (buckets.size() - 1);
+    made.next = buckets[bucket];
+    buckets[bucket] = node;
+    if (liveNodes > buckets.size()) rehash(buckets.size() * 2);
+    return node;
+}
+
+uint32_t HashLife::emptyNode(int level) {
+    while (int(emptyNodes.size()) <= level) {
+        uint32_t below = emptyNodes.back();
+        emptyNodes.push_back(join(below, below, below, below));
+    }
+    return emptyNodes[level];
+}
+
+/*
+ * Method: center
+ * --------------
+ * Returns the node of the next level down at the center of node, which must
+ * be of level 2 or more.
+ */
+uint32_t HashLife::center(uint32_t node) {
+    const uint32_t *c = nodes[node].child;
+    return join(nodes[c[0]].child[3], nodes[c[1]].child[2], nodes[c[2]].child[1], nodes[c[3]].child[0]);
+}
+
+/*
+ * Method: baseResult
+ * ------------------
+ * Returns the center of a 4 x 4 node one generation on, working each of
+ * the four cells out from its neighbors.
+ */
+uint32_t HashLife::baseResult(uint32_t node) {
+    bool alive[4][4];
+    for (int row = 0; row < 4; row++) {
+        for (int column = 0; column < 4; column++) {
+            uint32_t quadrant = nodes[node].child[(row / 2) * 2 + column / 2];
+            alive[row][column] = nodes[quadrant].child[(row % 2) * 2 + column % 2] == kLiveCell;
+        }
+    }
+    uint32_t cells[4];
+    for (int row = 1; row <= 2; row++) {
+        for (int column = 1; column <= 2; column++) {
+            int neighbors = 0;
+            for (int drow = -1; drow <= 1; drow++) {
+                for (int dcol = -1; dcol <= 1; dcol++) {
+                    if ((drow != 0 || dcol != 0) && alive[row + drow][column + dcol]) neighbors++;
+                }
+            }
+            bool next = neighbors == 3 || (neighbors == 2 && alive[row][column]);
+            cells[(row - 1) * 2 + column - 1] = next ? kLiveCell : kDeadCell;
+        }
+    }
+    return join(cells[0], cells[1], cells[2], cells[3]);
+}
+
+/*
+ * Method: result
+ * --------------
+ * Returns node's result, computing and caching it if need be.  node must be
+ * of level 2 or more and protected.
+ */
+uint32_t HashLife::result(uint32_t node) {
+    if (nodes[node].result != kNoNode) {
+        stats.cacheHits++;
+        return nodes[node].result;
+    }
+    stats.cacheMisses++;
+    int level = nodes[node].level;
+    uint32_t answer;
+    if (nodes[node].population == 0) {
+        answer = emptyNode(level - 1);
+    } else if (level == 2) {
+        answer = baseResult(node);
+    } else {
+        size_t mark = protect.size();
+        uint32_t nw = nodes[node].child[0], ne = nodes[node].child[1];
+        uint32_t sw = nodes[node].child[2], se = nodes[node].child[3];
+        uint32_t square[3][3];
+        square[0][0] = nw;
+        square[0][2] = ne;
+        square[2][0] = sw;
+        square[2][2] = se;
+        square[0][1] = join(nodes[nw].child[1], nodes[ne].child[0], nodes[nw].child[3], nodes[ne].child[2]);
+        protect.push_back(square[0][1]);
+        square[1][0] = join(nodes[nw].child[2], nodes[nw].child[3], nodes[sw].child[0], nodes[sw].child[1]);
+        protect.push_back(square[1][0]);
+        square[1][1] = center(node);
+        protect.push_back(square[1][1]);
+        square[1][2] = join(nodes[ne].child[2], nodes[ne].child[3], nodes[se].child[0], nodes[se].child[1]);
+        protect.push_back(square[1][2]);
+        square[2][1] = join(nodes[sw].child[1], nodes[se].child[0], nodes[sw].child[3], nodes[se].child[2]);
+        protect.push_back(square[2][1]);
+
+        bool fullSpeed = level - 2 <= stepLog;
+        uint32_t inner[3][3];
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 3; column++) {
+                inner[row][column] = fullSpeed ? result(square[row][column]) : center(square[row][column]);
+                protect.push_back(inner[row][column]);
+            }
+        }
+        uint32_t quarters[4];
+        for (int row = 0; row < 2; row++) {
+            for (int column = 0; column < 2; column++) {
+                uint32_t quarter = join(inner[row][column], inner[row][column + 1],
+                                        inner[row + 1][column], inner[row + 1][column + 1]);
+                protect.push_back(quarter);
+                quarters[row * 2 + column] = result(quarter);
+                protect.push_back(quarters[row * 2 + column]);
+            }
+        }
+        answer = join(quarters[0], quarters[1], quarters[2], quarters[3]);
+        protect.resize(mark);
+    }
+    nodes[node].result = answer;
+    return answer;
+}
+
+/*
+ * Method: load
+ * ------------
+ * Builds the tree from the bottom up: the grid's cells, padded with dead
+ * ones to a square whose side is a power of two, are joined four at a time
+ * into the next level until one node is left.  Each level is kept on the
+ * protect stack while the next is built.
+ */
+void HashLife::load(const Grid<int>& grid) {
+    reset();
+    int level = kMinRootLevel;
+    while ((int64_t(1) << level) < max(grid.numRows(), grid.numCols())) level++;
+    int side = 1 << level;
+    protect.reserve(size_t(side) * side);
+    for (int row = 0; row < side; row++) {
+        for (int column = 0; column < side; column++) {
+            bool alive = grid.inBounds(row, column) && grid.get(row, column) != 0;
+            protect.push_back(alive ? kLiveCell : kDeadCell);
+        }
+    }
+    size_t begin = 0;
+    for (; side > 1; side /= 2) {
+        size_t end = protect.size();
+        for (int row = 0; row < side; row += 2) {
+            for (int column = 0; column < side; column += 2) {
+                const uint32_t *top = &protect[begin + size_t(row) * side + column];
+                const uint32_t *bottom = top + side;
+                uint32_t nw = top[0], ne = top[1], sw = bottom[0], se = bottom[1];
+                protect.push_back(join(nw, ne, sw, se));
+            }
+        }
+        begin = end;
+    }
+    root = protect.back();
+    protect.clear();
+}
+
+/*
+ * Method: expand
+ * --------------
+ * Doubles the side of the root, keeping the old root at the center.
+ */
+void HashLife::expand() {
+    int level = nodes[root].level;
+    if (level >= kMaxRootLevel) error("HashLife pattern has grown too large.");
+    size_t mark = protect.size();
+    uint32_t empty = emptyNode(level - 1);
+    const uint32_t *c = nodes[root].child;
+    uint32_t nw = c[0], ne = c[1], sw = c[2], se = c[3];
+    protect.push_back(join(empty, empty, empty, nw));
+    protect.push_back(join(empty, empty, ne, empty));
+    protect.push_back(join(empty, sw, empty, empty));
+    protect.push_back(join(se, empty, empty, empty));
+    root = join(protect[mark], protect[mark + 1], protect[mark + 2], protect[mark + 3]);
+    protect.resize(mark);
+    int64_t shift = int64_t(1) << (level - 1);
+    originRow -= shift;
+    originColumn -= shift;
+}
+
+/*
+ * Method: setStepLog
+ * ------------------
+ * The cached results assume a step size, so all of them are discarded when
+ * it changes.
+ */
+void HashLife::setStepLog(int log2Generations) {
+    if (log2Generations == stepLog) return;
+    for (size_t node = 0; node < nodes.size(); node++) {
+        if (nodes[node].result != kNoNode && nodes[node].level >= 0) {
+            nodes[node].result = kNoNode;
+            stats.resultsDiscarded++;
+        }
+    }
+    stepLog = log2Generations;
+}
+
+/*
+ * Method: jump
+ * ------------
+ * A root's result covers its center half and is 2^min(stepLog, level - 2)
+ * generations on, and nothing moves faster than a cell a generation, so the
+ * root is first grown until the pattern lies within its center quarter and
+ * the jump is no more than 2^(level - 3) generations.  The result then
+ * holds everything the pattern can reach and becomes the new root.
+ */
+void HashLife::jump(int log2Generations) {
+    if (log2Generations < 0 || log2Generations > kMaxRootLevel - 3) {
+        error("HashLife can only jump 2^0 to 2^59 generations at once.");
+    }
+    setStepLog(log2Generations);
+    while (true) {
+        int level = nodes[root].level;
+        if (level < kMinRootLevel) {
+            expand();
+            continue;
+        }
+        const uint32_t *c = nodes[root].child;
+        uint64_t inner = nodes[nodes[nodes[c[0]].child[3]].child[3]].population
+                       + nodes[nodes[nodes[c[1]].child[2]].child[2]].population
+                       + nodes[nodes[nodes[c[2]].child[1]].child[1]].population
+                       + nodes[nodes[nodes[c[3]].child[0]].child[0]].population;
+        if (level >= log2Generations + 3 && inner == nodes[root].population) break;
+        expand();
+    }
+    int level = nodes[root].level;
+    root = result(root);
+    int64_t shift = int64_t(1) << (level - 2);
+    originRow += shift;
+    originColumn += shift;
+    generations += uint64_t(1) << log2Generations;
+}
+
+void HashLife::advance(uint64_t count) {
+    for (int bit = 0; count != 0; bit++, count >>= 1) {
+        if (count & 1) jump(bit);
+    }
+}
+
+uint64_t HashLife::generation() const {
+    return generations;
+}
+
+uint64_t HashLife::population() const {
+    return nodes[root].population;
+}
+
+bool HashLife::isAlive(int64_t row, int64_t column) const {
+    int level = nodes[root].level;
+    row -= originRow;
+    column -= originColumn;
+    if (row < 0 || column < 0 || row >= (int64_t(1) << level) || column >= (int64_t(1) << level)) return false;
+    uint32_t node = root;
+    for (; level > 0; level--) {
+        int64_t half = int64_t(1) << (level - 1);
+        int quadrant = (row >= half ? 2 : 0) + (column >= half ? 1 : 0);
+        node = nodes[node].child[quadrant];
+        if (nodes[node].population == 0) return false;
+        row %= half;
+        column %= half;
+    }
+    return node == kLiveCell;
+}
+
+void HashLife::collectGarbage() {
+    collect(true);
+}
+
+/*
+ * Method: collect
+ * ---------------
+ * Marks every node reachable from the root, the empty nodes, and the
+ * protect stack, following cached results too if keepResults is set, then
+ * frees the rest and rebuilds the hash chains from the survivors.  A
+ * surviving node whose result was freed forgets it.
+ */
+void HashLife::collect(bool keepResults) {
+    vector<char> marked(nodes.size(), 0);
+    vector<uint32_t> stack(protect);
+    stack.push_back(root);
+    stack.insert(stack.end(), emptyNodes.begin(), emptyNodes.end());
+    marked[kDeadCell] = marked[kLiveCell] = 1;
+    while (!stack.empty()) {
+        uint32_t node = stack.back();
+        stack.pop_back();
+        if (marked[node]) continue;
+        marked[node] = 1;
+        for (int quadrant = 0; quadrant < 4; quadrant++) {
+            stack.push_back(nodes[node].child[quadrant]);
+        }
+        if (keepResults && nodes[node].result != kNoNode) stack.push_back(nodes[node].result);
+    }
+    for (size_t node = kLiveCell + 1; node < nodes.size(); node++) {
+        Node& entry = nodes[node];
+        if (entry.level < 0) continue;
+        if (!marked[node]) {
+            entry.level = -1;
+            entry.result = kNoNode;
+            entry.next = freeList;
+            freeList = node;
+            liveNodes--;
+            stats.nodesFreed++;
+        } else if (entry.result != kNoNode && !marked[entry.result]) {
+            entry.result = kNoNode;
+            stats.resultsEvicted++;
+        }
+    }
+    size_t numBuckets = kMinBuckets;
+    while (numBuckets < liveNodes) numBuckets *= 2;
+    rehash(numBuckets);
+    stats.collections++;
+}
+
+HashLife::Statistics HashLife::statistics() const {
+    Statistics current = stats;
+    current.nodes = liveNodes;
+    current.maxNodes = maxNodes;
+    current.memoryBytes = nodes.capacity() * sizeof(Node) + buckets.size() * sizeof(uint32_t);
+    return current;
+}
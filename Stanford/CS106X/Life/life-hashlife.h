@@ -0,0 +1,151 @@
+/**
+ * File: life-hashlife.h
+ * ---------------------
+ * Defines HashLife, a Game of Life engine for patterns that run for a very
+ * long time.  The plane is a quadtree whose nodes are shared: every square
+ * of cells that appears more than once, anywhere or at any time, is stored
+ * once.  Each node remembers what its center becomes some generations
+ * later, so a pattern that repeats itself in space or time is advanced by
+ * looking results up rather than computing them again, and the engine can
+ * jump 2^k generations in one step.
+ *
+ * Unlike the other engines, HashLife plays on the unbounded plane: nothing
+ * stops at the edge of the grid a pattern is loaded from.  The results agree
+ * with theirs for as long as the pattern stays clear of those edges.
+ */
+
+#ifndef _life_hashlife_h_
+#define _life_hashlife_h_
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t, uint64_t, int64_t
+#include <vector>    // for std::vector
+#include "grid.h"    // for Grid
+
+/* The memory a HashLife uses unless it is given another limit. */
+const size_t kDefaultHashLifeMemory = size_t(256) << 20;
+
+class HashLife {
+public:
+
+    /**
+     * Counters kept since the engine was created.  A lookup is a hit when a
+     * node already knew its result.  Results are discarded wholesale when
+     * the step size changes, and evicted by garbage collection when the
+     * node they point to is collected.
+     */
+    struct Statistics {
+        size_t nodes;                   /* nodes in use now */
+        size_t maxNodes;                /* the most the memory limit allows */
+        size_t memoryBytes;             /* memory held by the node and hash tables */
+        uint64_t cacheHits;
+        uint64_t cacheMisses;
+        uint64_t resultsDiscarded;
+        uint64_t resultsEvicted;
+        uint64_t collections;
+        uint64_t nodesFreed;
+    };
+
+    /**
+     * Creates an engine with an empty plane that will use no more than about
+     * memoryLimit bytes.  When the nodes fill that, unreachable nodes are
+     * collected, and if that is not enough the cached results are dropped
+     * too; only if the live pattern alone does not fit is an error raised.
+     */
+    explicit HashLife(size_t memoryLimit = kDefaultHashLifeMemory);
+
+    /**
+     * Replaces the plane with the live cells of grid, with the grid's upper
+     * left corner at row 0, column 0, and sets the generation back to 0.
+     * Ages are not kept.
+     */
+    void load(const Grid<int>& grid);
+
+    /**
+     * Advances the pattern by 2^log2Generations generations at once.
+     */
+    void jump(int log2Generations);
+
+    /**
+     * Advances the pattern by any number of generations, as a series of
+     * jumps by the powers of two that add up to it.
+     */
+    void advance(uint64_t generations);
+
+    /**
+     * Returns the number of generations since load.
+     */
+    uint64_t generation() const;
+
+    /**
+     * Returns the number of live cells.
+     */
+    uint64_t population() const;
+
+    /**
+     * Returns whether the cell at row and column is alive.  Any row and
+     * column may be asked about, including negative ones.
+     */
+    bool isAlive(int64_t row, int64_t column) const;
+
+    /**
+     * Frees every node that is no longer part of the pattern or of a cached
+     * result.  This happens on its own when memory runs short.
+     */
+    void collectGarbage();
+
+    /**
+     * Returns the counters described above.
+     */
+    Statistics statistics() const;
+
+private:
+    /*
+     * A square of 2^level cells on a side.  Level 0 nodes are single cells:
+     * node 0 is dead and node 1 alive.  Larger nodes have four children of
+     * the next level down, in the order northwest, northeast, southwest,
+     * southeast.  result, once known, is the node of the next level down at
+     * this node's center, 2^min(stepLog, level - 2) generations on.  next
+     * links nodes in the same hash bucket, or free nodes together; a free
+     * node has level -1.
+     */
+    struct Node {
+        uint32_t child[4];
+        uint32_t result;
+        uint32_t next;
+        uint64_t population;
+        int level;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> buckets;      /* heads of the hash chains; a power of two of them */
+    std::vector<uint32_t> emptyNodes;   /* the empty node of each level */
+    std::vector<uint32_t> protect;      /* nodes in use by a computation under way */
+    uint32_t freeList;
+    size_t liveNodes;
+    size_t maxNodes;
+    uint32_t root;
+    int64_t originRow;                  /* the cell at root's upper left corner */
+    int64_t originColumn;
+    uint64_t generations;
+    int stepLog;
+    Statistics stats;
+
+    void reset();
+    uint32_t allocate();
+    uint32_t join(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se);
+    uint32_t emptyNode(int level);
+    uint32_t center(uint32_t node);
+    uint32_t baseResult(uint32_t node);
+    uint32_t result(uint32_t node);
+    void expand();
+    void setStepLog(int log2Generations);
+    void collect(bool keepResults);
+    void rehash(size_t numBuckets);
+    void insert(uint32_t node);
+
+    HashLife(const HashLife& original);
+    void operator=(const HashLife& rhs) const;
+};
+
+#endif
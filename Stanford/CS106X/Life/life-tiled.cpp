@@ -0,0 +1,160 @@
+/**
+ * File: life-tiled.cpp
+ * --------------------
+ * Implementation of TiledBoard.  Skipping a tile relies on one rule: a
+ * tile that is not marked as changed holds the same cells in both buffers.
+ * A computed tile that came out unchanged has just written its present
+ * cells into the back buffer, and a skipped tile wrote nothing, so the two
+ * copies still agree after the buffers are swapped.  setAlive breaks the
+ * rule for one tile and marks it changed, which gets it computed again.
+ */
+
+#include <algorithm> // for min
+using namespace std;
+#include "error.h"   // for error
+#include "strlib.h"  // for integerToString
+
+#include "life-tiled.h"
+#include "life-bitboard.h"   // for nextWord
+
+static const int kWordBits = 64;
+
+TiledBoard::TiledBoard(int numRows, int numCols, int numThreads) : pool(numThreads) {
+    if (numRows < 0 || numCols < 0) error("TiledBoard given a negative size.");
+    rows = numRows;
+    cols = numCols;
+    wordsPerRow = (cols + kWordBits - 1) / kWordBits;
+    tileRows = (rows + kTileRows - 1) / kTileRows;
+    tileCols = (wordsPerRow + kTileWords - 1) / kTileWords;
+    int lastBits = cols % kWordBits;
+    lastWordMask = lastBits == 0 ? ~uint64_t(0) : (uint64_t(1) << lastBits) - 1;
+    size_t words = size_t(rows + 2) * wordsPerRow;
+    cells.assign(words, 0);
+    next.assign(words, 0);
+    changed.assign(size_t(tileRows) * tileCols, 0);
+    computed = 0;
+}
+
+int TiledBoard::numRows() const {
+    return rows;
+}
+
+int TiledBoard::numCols() const {
+    return cols;
+}
+
+void TiledBoard::checkLocation(int row, int column) const {
+    if (row < 0 || row >= rows || column < 0 || column >= cols) {
+        error("TiledBoard location (" + integerToString(row) + ", " + integerToString(column)
+              + ") is outside the board.");
+    }
+}
+
+bool TiledBoard::isAlive(int row, int column) const {
+    checkLocation(row, column);
+    return (cells[size_t(row + 1) * wordsPerRow + column / kWordBits] >> (column % kWordBits)) & 1;
+}
+
+void TiledBoard::setAlive(int row, int column, bool alive) {
+    checkLocation(row, column);
+    uint64_t bit = uint64_t(1) << (column % kWordBits);
+    uint64_t &word = cells[size_t(row + 1) * wordsPerRow + column / kWordBits];
+    if (alive) {
+        word |= bit;
+    } else {
+        word &= ~bit;
+    }
+    changed[size_t(row / kTileRows) * tileCols + column / kWordBits / kTileWords] = 1;
+}
+
+void TiledBoard::load(const Grid<int>& grid) {
+    if (grid.numRows() != rows || grid.numCols() != cols) error("TiledBoard::load given a grid of another size.");
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < cols; column++) {
+            setAlive(row, column, grid.get(row, column) != 0);
+        }
+    }
+}
+
+long TiledBoard::population() const {
+    long count = 0;
+    for (size_t i = 0; i < cells.size(); i++) {
+        count += __builtin_popcountll(cells[i]);
+    }
+    return count;
+}
+
+int TiledBoard::numTiles() const {
+    return changed.size();
+}
+
+int TiledBoard::tilesComputed() const {
+    return computed;
+}
+
+/*
+ * Method: step
+ * ------------
+ * Lists the tiles that changed or touch one that did, computes them on the
+ * pool, and swaps the buffers.  The list is in row order, so each thread's
+ * slice of it is a band of the board and most of the border it reads is
+ * its own.
+ */
+bool TiledBoard::step() {
+    active.clear();
+    for (int tileRow = 0; tileRow < tileRows; tileRow++) {
+        for (int tileCol = 0; tileCol < tileCols; tileCol++) {
+            bool stirred = false;
+            for (int i = max(tileRow - 1, 0); i <= min(tileRow + 1, tileRows - 1) && !stirred; i++) {
+                for (int j = max(tileCol - 1, 0); j <= min(tileCol + 1, tileCols - 1); j++) {
+                    if (changed[size_t(i) * tileCols + j]) {
+                        stirred = true;
+                        break;
+                    }
+                }
+            }
+            if (stirred) active.push_back(tileRow * tileCols + tileCol);
+        }
+    }
+    computed = active.size();
+    if (active.empty()) return false;
+    pool.forEach(active.size(), [this](int i) { stepTile(active[i]); });
+    cells.swap(next);
+    for (size_t i = 0; i < active.size(); i++) {
+        if (changed[active[i]]) return true;
+    }
+    return false;
+}
+
+/*
+ * Method: stepTile
+ * ----------------
+ * Computes one tile's cells of the next generation and records whether
+ * they changed.  The rows above and below the tile and the words on either
+ * side of it are read straight from the present generation, which nobody
+ * writes during the step, so the border needs no copying.
+ */
+void TiledBoard::stepTile(int tile) {
+    int firstRow = tile / tileCols * kTileRows;
+    int endRow = min(firstRow + kTileRows, rows);
+    int firstWord = tile % tileCols * kTileWords;
+    int endWord = min(firstWord + kTileWords, wordsPerRow);
+    uint64_t difference = 0;
+    for (int row = firstRow; row < endRow; row++) {
+        const uint64_t *above = &cells[size_t(row) * wordsPerRow];
+        const uint64_t *middle = above + wordsPerRow;
+        const uint64_t *below = middle + wordsPerRow;
+        uint64_t *out = &next[size_t(row + 1) * wordsPerRow];
+        for (int word = firstWord; word < endWord; word++) {
+            bool first = word == 0;
+            bool last = word + 1 == wordsPerRow;
+            uint64_t after = nextWord(first ? 0 : above[word - 1], above[word], last ? 0 : above[word + 1],
+                                      first ? 0 : middle[word - 1], middle[word], last ? 0 : middle[word + 1],
+                                      first ? 0 : below[word - 1], below[word], last ? 0 : below[word + 1]);
+            if (last) after &= lastWordMask;
+            out[word] = after;
+            difference |= after ^ middle[word];
+        }
+    }
+    changed[tile] = difference != 0;
+}
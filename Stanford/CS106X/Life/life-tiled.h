@@ -0,0 +1,98 @@
+/**
+ * File: life-tiled.h
+ * ------------------
+ * Defines TiledBoard, a Game of Life board for big boards and many cores.
+ * Cells are packed 64 to a word as in BitBoard, and the board is cut into
+ * tiles of kTileRows rows by kTileWords words, small enough to stay in a
+ * core's cache while it is computed.  The tiles of a generation are spread
+ * over a WorkPool; each reads a one-cell border from the tiles around it
+ * in the present generation and writes only its own cells of the next, so
+ * the threads never wait on one another until the generation is done.
+ *
+ * A tile whose cells did not change in the last generation, and none of
+ * whose eight neighbors changed, would only come out the same again, so it
+ * is not computed at all.  Ages are not kept; this board is for running
+ * patterns far too big for the display.
+ */
+
+#ifndef _life_tiled_h_
+#define _life_tiled_h_
+
+#include <stdint.h>  // for uint8_t, uint64_t
+#include <vector>    // for std::vector
+#include "grid.h"    // for Grid
+#include "life-workpool.h"
+
+/* The size of a tile: 256 by 256 cells, 8 KiB. */
+const int kTileRows = 256;
+const int kTileWords = 4;
+
+class TiledBoard {
+public:
+
+    /**
+     * Creates a board of the given size with every cell dead, stepped by
+     * numThreads threads.
+     */
+    TiledBoard(int numRows, int numCols, int numThreads);
+
+    int numRows() const;
+    int numCols() const;
+
+    /**
+     * Returns whether the cell at row and column is alive.  Raises an error if
+     * the location is not on the board.
+     */
+    bool isAlive(int row, int column) const;
+
+    /**
+     * Brings the cell at row and column to life, or kills it.
+     */
+    void setAlive(int row, int column, bool alive);
+
+    /**
+     * Copies grid, which must be the size of the board, treating every
+     * nonzero value as a live cell.
+     */
+    void load(const Grid<int>& grid);
+
+    /**
+     * Returns the number of live cells.
+     */
+    long population() const;
+
+    /**
+     * Advances the board by one generation and returns whether any cell
+     * changed.
+     */
+    bool step();
+
+    /**
+     * Returns the number of tiles, and how many of them the last step
+     * computed rather than skipped.
+     */
+    int numTiles() const;
+    int tilesComputed() const;
+
+private:
+    int rows;
+    int cols;
+    int wordsPerRow;
+    int tileRows;                        /* tiles down the board */
+    int tileCols;                        /* tiles across it */
+    uint64_t lastWordMask;               /* the bits of the last word of a row that are on the board */
+    std::vector<uint64_t> cells;         /* a dead row above and below the board, then wordsPerRow per row */
+    std::vector<uint64_t> next;          /* the other generation, laid out the same */
+    std::vector<uint8_t> changed;        /* per tile: changed in the last step, or set by hand since */
+    std::vector<int> active;             /* the tiles the current step computes */
+    int computed;
+    WorkPool pool;
+
+    void checkLocation(int row, int column) const;
+    void stepTile(int tile);
+
+    TiledBoard(const TiledBoard& original);
+    void operator=(const TiledBoard& rhs) const;
+};
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * File: life-workpool.cpp
+ * -----------------------
+ * Implementation of WorkPool.  A round is published under the lock by
+ * bumping round, which is what the workers wait on; the slices are filled
+ * in before that, so the lock also makes them visible to every worker.
+ */
+
+#include <stddef.h>  // for NULL
+using namespace std;
+#include "error.h"   // for error
+
+#include "life-workpool.h"
+
+WorkPool::WorkPool(int numThreads) : slices(numThreads < 1 ? 1 : numThreads) {
+    if (numThreads < 1) error("WorkPool needs at least one thread.");
+    task = NULL;
+    round = 0;
+    busy = 0;
+    stopping = false;
+    for (int i = 1; i < numThreads; i++) {
+        workers.push_back(thread(&WorkPool::run, this, i));
+    }
+}
+
+WorkPool::~WorkPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+int WorkPool::numThreads() const {
+    return slices.size();
+}
+
+void WorkPool::forEach(int count, const function<void(int)>& task) {
+    if (count <= 0) return;
+    int numSlices = slices.size();
+    for (int i = 0; i < numSlices; i++) {
+        slices[i].next = long(count) * i / numSlices;
+        slices[i].end = long(count) * (i + 1) / numSlices;
+    }
+    this->task = &task;
+    if (workers.empty()) {
+        work(0);
+        return;
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        busy = workers.size();
+        round++;
+    }
+    wake.notify_all();
+    work(0);
+    unique_lock<mutex> guard(lock);
+    finished.wait(guard, [this] { return busy == 0; });
+}
+
+/*
+ * Method: run
+ * -----------
+ * The loop each worker runs: wait for a round it has not seen, take part in
+ * it, and report back when it has nothing left to claim.
+ */
+void WorkPool::run(int self) {
+    unsigned long seen = 0;
+    while (true) {
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [this, seen] { return stopping || round != seen; });
+            if (stopping) return;
+            seen = round;
+        }
+        work(self);
+        lock_guard<mutex> guard(lock);
+        if (--busy == 0) finished.notify_one();
+    }
+}
+
+/*
+ * Method: work
+ * ------------
+ * Claims and runs indices from the thread's own slice until it is empty,
+ * then from each of the other slices in turn.  An index past a slice's end
+ * means the slice is used up; the counter may run past the end by one for
+ * each thread, which is harmless.
+ */
+void WorkPool::work(int self) {
+    int numSlices = slices.size();
+    for (int k = 0; k < numSlices; k++) {
+        Slice& slice = slices[(self + k) % numSlices];
+        while (true) {
+            int index = slice.next.fetch_add(1);
+            if (index >= slice.end) break;
+            (*task)(index);
+        }
+    }
+}
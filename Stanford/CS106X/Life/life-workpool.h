@@ -0,0 +1,76 @@
+/**
+ * File: life-workpool.h
+ * ---------------------
+ * Defines WorkPool, a set of threads that run a task once for each index
+ * in a range and return when all of them are done.  It is built for work
+ * that is handed out again and again in short rounds, such as one round
+ * of tiles per generation: the threads stay alive between rounds, and an
+ * index is claimed with one atomic add rather than through a locked queue.
+ */
+
+#ifndef _life_workpool_h_
+#define _life_workpool_h_
+
+#include <atomic>              // for std::atomic
+#include <condition_variable>  // for std::condition_variable
+#include <functional>          // for std::function
+#include <mutex>               // for std::mutex
+#include <thread>              // for std::thread
+#include <vector>              // for std::vector
+
+class WorkPool {
+public:
+
+    /**
+     * Creates a pool of numThreads threads, counting the one that calls
+     * forEach, which works alongside the others.  A pool of one thread
+     * starts none and runs everything on the caller.
+     */
+    explicit WorkPool(int numThreads);
+
+    /**
+     * Stops and joins the threads.
+     */
+    ~WorkPool();
+
+    int numThreads() const;
+
+    /**
+     * Calls task(i) for every i from 0 up to count, spread over the threads,
+     * and returns once every call has returned.  Each thread starts on its
+     * own contiguous slice of the range, so neighboring indices tend to run
+     * on the same thread, and a thread that finishes its slice steals the
+     * indices left in the others'.  The task must not throw.
+     */
+    void forEach(int count, const std::function<void(int)>& task);
+
+private:
+    /*
+     * The indices from next up to end that nobody has claimed yet.  Any
+     * thread may claim one by adding to next; the padding keeps each slice's
+     * counter on a cache line of its own.
+     */
+    struct Slice {
+        std::atomic<int> next;
+        int end;
+        char padding[56];
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<Slice> slices;
+    const std::function<void(int)> *task;
+    std::mutex lock;
+    std::condition_variable wake;       /* signaled when a round starts or the pool stops */
+    std::condition_variable finished;   /* signaled when the last worker ends its round */
+    unsigned long round;
+    int busy;                           /* workers still in the current round */
+    bool stopping;
+
+    void run(int self);
+    void work(int self);
+
+    WorkPool(const WorkPool& original);
+    void operator=(const WorkPool& rhs) const;
+};
+
+#endif
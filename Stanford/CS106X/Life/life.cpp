@@ -17,33 +17,39 @@ using namespace std;
 
 #include "life-constants.h"  // for kMaxAge
 #include "life-graphics.h"   // for class LifeDisplay
+#include "life-bitboard.h"   // for class BitBoard
+#include "life-benchmark.h"  // for the benchmark functions
 
 static void waitForEnter(string message);
 static string welcome();
 static int simulationSpeed();
 static string selectFile(string preparedFile);
 static Grid<int> createGrid(Grid<int>& presentGrid, string file);
-static void displayPresentGrid(Grid<int>& presentGrid, LifeDisplay& display);
-static void updateFutureGrid(Grid<int>& futureGrid, Grid<int> presentGrid);
-static void updateCell(Grid<int>& futureGrid, Grid<int> presentGrid, int i, int j);
-static void runSim(Grid<int>& futureGrid, Grid<int>& presentGrid, LifeDisplay& display, int simSpeed);
-static void runAgain(Grid<int>& futureGrid, Grid<int>& presentGrid, LifeDisplay& display);
+static void displayBoard(const BitBoard& board, LifeDisplay& display);
+static void displayChanges(const BitBoard& board, LifeDisplay& display);
+static void runSim(BitBoard& board, LifeDisplay& display, int simSpeed);
+static void runAgain(Grid<int>& presentGrid, BitBoard& board, LifeDisplay& display);
 
 int main() {
+    //benchmarkBitBoard(16384, 10);
+    //benchmarkGridBoard(1024);
+    //benchmarkHashLife("Glider Gun", 32);
+    //benchmarkTiledBoard(16384, 100);
+    //benchmarkSparseBitBoard(2048, 5000);
     LifeDisplay display;
     display.setTitle("Game of Life");
     int numCols = randomInteger(40, 61);
     int numRows = randomInteger(40, 61);
     Grid<int> presentGrid(numRows, numCols);
-    Grid<int> futureGrid(numRows, numCols);
+    BitBoard board;
     string file = welcome();
     int simSpeed = simulationSpeed();
-    futureGrid = presentGrid = createGrid(presentGrid, file);
-    display.setDimensions(presentGrid.numRows(), presentGrid.numCols());
-    displayPresentGrid(presentGrid, display);
-    updateFutureGrid(futureGrid, presentGrid);
-    runSim(futureGrid, presentGrid, display, simSpeed);
-    runAgain(futureGrid, presentGrid, display);
+    presentGrid = createGrid(presentGrid, file);
+    board.load(presentGrid);
+    display.setDimensions(board.numRows(), board.numCols());
+    displayBoard(board, display);
+    runSim(board, display, simSpeed);
+    runAgain(presentGrid, board, display);
     return 0;
 }
 
@@ -189,82 +195,47 @@ static Grid<int> createGrid(Grid<int>& presentGrid, string file){
 }
 
 /*
- * function: displayPresentGrid(presentGrid)
- * usage: displayPresentGrid(presentGrid);
+ * function: displayBoard(board, display)
+ * usage: displayBoard(board, display);
  * -------------------
- * uses function drawCellAt from life-graphics.cpp to display the cells
- * in the present grid.
+ * uses function drawCellAt from life-graphics.cpp to display every cell
+ * of the board.
  */
 
-static void displayPresentGrid(Grid<int>& presentGrid, LifeDisplay& display){
-    for (int i=0; i<presentGrid.numRows(); i++){
-        for (int j=0; j<presentGrid.numCols(); j++){
-                display.drawCellAt(i, j, presentGrid[i][j]);
+static void displayBoard(const BitBoard& board, LifeDisplay& display){
+    for (int i=0; i<board.numRows(); i++){
+        for (int j=0; j<board.numCols(); j++){
+                display.drawCellAt(i, j, board.ageAt(i, j));
         }
     }
 }
 
-
 /*
- * function: updateFutureGrid(futureGrid, presentGrid)
- * usage: updateFutureGrid(futureGrid, presentGrid);
+ * function: displayChanges(board, display)
+ * usage: displayChanges(board, display);
  * -------------------
- * This function loops through every cell in the grid, and updates the cell in futureGrid
- * by calling updateCell().
+ * Redraws only the cells whose age changed in the last generation; the rest
+ * of the window already shows them correctly.
  */
-static void updateFutureGrid(Grid<int>& futureGrid, Grid<int> presentGrid){
-    for (int i=0; i<presentGrid.numRows(); i++){
-        for (int j = 0; j<presentGrid.numCols(); j++){
-            updateCell(futureGrid, presentGrid, i, j);
-        }
-    }
-}
 
-/*
- * function: updateCell(futureGrid, presentGrid, i, j)
- * usage: updateCell(futureGrid, presentGrid, i, j);
- * -------------------
- * Update cell checks all cells surrounding presentGrid[i][j].  It counts how many neighboring cells are
- * living, and updates futureGrid[i][j] based on that count and the rules explained in welcome().
- */
-static void updateCell(Grid<int>& futureGrid, Grid<int> presentGrid, int i, int j){
-    int numNeighbors = 0;
-    for (int drow = -1; drow <= 1; drow++) {
-        for (int dcol = -1; dcol <= 1; dcol++) {                /* Loops through all neighbors of the cell. If   */
-            if (presentGrid.inBounds(i+drow, j+dcol)) {         /* a neighbor has value has a cell, increment    */
-                if (dcol == 0 && drow == 0){                    /* the numNeighbor counter.  The counter is not  */
-                    numNeighbors += 0;                          /* incremented for the cell itself. The value of */
-                }else if (presentGrid[i+drow][j+dcol] != 0){    /* the counter after these loops is the number of*/
-                    numNeighbors += 1;                          /* neighbors.                                    */
-                }
-            }
-        }
-    }
-    if (numNeighbors == 2){
-        if (futureGrid[i][j] > 0 && futureGrid[i][j] < kMaxAge){
-            futureGrid[i][j] += 1;
-        }
-    }else if (numNeighbors == 3){
-        if (futureGrid[i][j] < kMaxAge){
-            futureGrid[i][j] += 1;
-        }
-    } else{
-        futureGrid[i][j] = 0;
+static void displayChanges(const BitBoard& board, LifeDisplay& display){
+    const vector<pair<int, int> >& changes = board.changedCells();
+    for (size_t k = 0; k < changes.size(); k++){
+        display.drawCellAt(changes[k].first, changes[k].second, board.ageAt(changes[k].first, changes[k].second));
     }
 }
 
 
 /*
- * function: runSim(futureGrid, presentGrid, display)
- * usage: runSim(futureGrid, presentGrid, display);
+ * function: runSim(board, display, simSpeed)
+ * usage: runSim(board, display, simSpeed);
  * -------------------
  * This function runs the simulation. It starts by checking if the mouse has been clicked.  If it has, it ends the simulation.
- * If not, it checks to see if futureBoard and presentBoard are the same.  If they are, the simulation has stablized and it ends.
- * If not, it waits based on user input in simulationSpeed(), and copys futureGrid into presentGrid.  presentGrid is displayed,
- * and futureGrid is updated again.  This loop then continues until the mouse is clicked, or presentSim and futureSim are the same
- * after updateFutureGrid is run.
+ * If not, it advances the board a generation.  If nothing changed, not even a cell's age, the simulation has stablized and
+ * it ends.  If not, it waits based on user input in simulationSpeed() and redraws the cells that changed.  This loop then
+ * continues until the mouse is clicked, or a generation leaves the board as it was.
  */
-static void runSim(Grid<int>& futureGrid, Grid<int>& presentGrid, LifeDisplay& display, int simSpeed){
+static void runSim(BitBoard& board, LifeDisplay& display, int simSpeed){
     while (true) {
         GMouseEvent me = getNextEvent(MOUSE_EVENT);\
         if (me.getEventType() == MOUSE_CLICKED) {
@@ -272,7 +243,7 @@ static void runSim(Grid<int>& futureGrid, Grid<int>& presentGrid, LifeDisplay& d
         } else if (me.getEventType() == NULL_EVENT) {
             // only advance board if there aren’t any outstanding mouse events
             //advanceBoard(futureGrid, presentGrid, display);
-            if (futureGrid.toString() == presentGrid.toString()){
+            if (!board.step()){
                 return;
             }else {
                 if (simSpeed == 2){
@@ -282,23 +253,21 @@ static void runSim(Grid<int>& futureGrid, Grid<int>& presentGrid, LifeDisplay& d
                 }else if(simSpeed == 4){
                     waitForEnter("Hit [enter] to display next generation.");
                 }
-                presentGrid = futureGrid;
-                displayPresentGrid(presentGrid, display);
-                updateFutureGrid(futureGrid, presentGrid);
+                displayChanges(board, display);
             }
         }
     }
 }
 
 /*
- * function: runAgain(futureGrid, presentGrid, display)
- * usage: runAgain(futureGrid, presentGrid, display);
+ * function: runAgain(presentGrid, board, display)
+ * usage: runAgain(presentGrid, board, display);
  * -------------------
  * After the simulation ends, runAgain asks the user if they would like to run another simulation.  If the user answers yes,
  * the simulation is rerun.  If the user answers no, the program exits after the user hits enter.
  *
  */
-static void runAgain(Grid<int>& futureGrid, Grid<int>& presentGrid, LifeDisplay& display){
+static void runAgain(Grid<int>& presentGrid, BitBoard& board, LifeDisplay& display){
     cout << "The simulation has ended." << endl;
     string rerun;
     while (rerun != "yes" && rerun != "no"){
@@ -320,12 +289,12 @@ static void runAgain(Grid<int>& futureGrid, Grid<int>& presentGrid, LifeDisplay&
         inputFile = selectFile(preparedFile);
         string file = inputFile;
         int simSpeed = simulationSpeed();
-        futureGrid = presentGrid = createGrid(presentGrid, file);
-        display.setDimensions(presentGrid.numRows(), presentGrid.numCols());
-        displayPresentGrid(presentGrid, display);
-        updateFutureGrid(futureGrid, presentGrid);
-        runSim(futureGrid, presentGrid, display, simSpeed);
-        runAgain(futureGrid, presentGrid, display);
+        presentGrid = createGrid(presentGrid, file);
+        board.load(presentGrid);
+        display.setDimensions(board.numRows(), board.numCols());
+        displayBoard(board, display);
+        runSim(board, display, simSpeed);
+        runAgain(presentGrid, board, display);
     }else{
         waitForEnter("Hit [enter] to exit....   ");
     }